@@ -1,624 +1,3570 @@
 #define BUFFER_SIZE 65536
 #define BASE_LENGTH 9
 #include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
-const unsigned long long BASE = pow(10, BASE_LENGTH);
+constexpr unsigned long long BASE = 1000000000;  // 10^BASE_LENGTH
 const unsigned long long MAX_DECIMAL_DIGITS = 10000;
 const size_t SIZE = 64;
 
 void parseString(std::string str, std::vector<u_int64_t>& dest);
 std::string numToString(u_int64_t number, bool fixW);
 
-class BigInteger {
- private:
-  size_t size_;
-  std::vector<u_int64_t> digits_;
-  bool negative_;
+// ==============Tuning==============
+
+// Limb-count cutovers between the multiplication, division and radix
+// conversion algorithms. The defaults were measured on x86-64; adjust them
+// per machine if needed.
+struct BigIntegerTuning {
+  static inline size_t karatsuba_threshold = 48;
+  static inline size_t square_threshold = 12;
+  static inline size_t toom3_threshold = 200;
+  static inline size_t ntt_threshold = 20000;
+  static inline size_t bz_threshold = 80;
+  static inline size_t radix_threshold = 20;
+  static inline size_t half_gcd_threshold = 400;
+  // Large multiplications hand subproducts to a process-wide pool of
+  // persistent helper threads, at most mul_threads - 1 of them busy at once
+  // across all callers; 1 keeps everything sequential. Subproducts go to
+  // helpers only when the smaller operand has at least parallel_threshold
+  // limbs.
+  static inline size_t mul_threads = 1;
+  // At 2000 limbs the smallest forked subproduct (a Toom-3 third) still
+  // costs ten times a hand-off to a sleeping helper.
+  static inline size_t parallel_threshold = 2000;
+  // Zero keeps every Rational reduced. Otherwise Rational results stay
+  // unreduced until they are printed or compared, or until numerator and
+  // denominator together pass this many limbs.
+  static inline size_t lazy_rational_limbs = 0;
+};
 
- public:
-  inline BigInteger() : BigInteger(0){};
-  inline BigInteger(int64_t number);  // bigint from number
+// ==============Limb kernels==============
+// Unsigned magnitudes are little-endian limb arrays; sizes are passed
+// explicitly and the kernels never allocate from the heap on their own.
 
-  inline BigInteger(int64_t number, size_t len);
+namespace bigint_detail {
 
-  inline BigInteger(std::string str);  // bigint from string
+using Limb = u_int64_t;
 
-  inline BigInteger(const BigInteger& other, bool negative);
+// ==============Limb arithmetic==============
+// Building with BIGINT_BINARY_LIMBS stores full 2^64 limbs; otherwise every
+// limb holds BASE_LENGTH decimal digits. Everything above these primitives
+// is radix-agnostic.
 
-  explicit operator bool() const;
+using DoubleLimb = unsigned __int128;
 
-  explicit operator double() const;
+#ifdef BIGINT_BINARY_LIMBS
+const Limb LIMB_MAX = ~Limb(0);
+const double LIMB_RADIX = 18446744073709551616.0;
+// Decimal groups short enough to fit a limb, and the largest such power.
+const size_t DECIMAL_GROUP = 19;
+const Limb DECIMAL_GROUP_POWER = 10000000000000000000ULL;
 
-  size_t len() const;
+inline Limb addCarry(Limb a, Limb b, Limb& carry) {
+  DoubleLimb sum = DoubleLimb(a) + b + carry;
+  carry = static_cast<Limb>(sum >> 64);
+  return static_cast<Limb>(sum);
+}
 
-  std::string toStringOld() const;
+inline Limb subBorrow(Limb a, Limb b, Limb& borrow) {
+  DoubleLimb diff = DoubleLimb(a) - b - borrow;
+  borrow = static_cast<Limb>(diff >> 127);
+  return static_cast<Limb>(diff);
+}
 
-  inline std::string toString() const;
+// Returns the low limb of a * b + c + carry and leaves the high one in carry.
+inline Limb mulAdd(Limb a, Limb b, Limb c, Limb& carry) {
+  DoubleLimb cur = DoubleLimb(a) * b + c + carry;
+  carry = static_cast<Limb>(cur >> 64);
+  return static_cast<Limb>(cur);
+}
 
-  uint64_t operator[](size_t index) const { return digits_[index]; }
+// hi * radix + lo as a double-width value.
+inline DoubleLimb wide(Limb hi, Limb lo) { return (DoubleLimb(hi) << 64) | lo; }
 
-  uint64_t& operator[](size_t index) { return digits_[index]; }
+// (hi * radix + lo) / d with hi < d; the remainder goes to rest.
+inline Limb divWide(Limb hi, Limb lo, Limb d, Limb& rest) {
+  DoubleLimb cur = wide(hi, lo);
+  rest = static_cast<Limb>(cur % d);
+  return static_cast<Limb>(cur / d);
+}
 
-  bool isNegative() const { return negative_; }
+// Factor that lifts a nonzero top limb to at least half the radix.
+inline Limb normalizer(Limb top) { return Limb(1) << __builtin_clzll(top); }
 
-  BigInteger operator-() const { return BigInteger(*this, !negative_); }
-  void invert() { negative_ = !negative_; };
+// The radix is RADIX_DIGITS powers of its digit, 2; powers of the digit are
+// limb and bit shifts.
+const size_t RADIX_DIGITS = 64;
 
-  void makeAbs() { negative_ = false; }
+// Whether a nonzero c is the digit to some power t.
+inline bool isDigitPower(Limb c, size_t& t) {
+  t = __builtin_ctzll(c);
+  return !(c & (c - 1));
+}
 
-  BigInteger abs() const { return BigInteger(*this, false); }
+// The digit to the power r < RADIX_DIGITS.
+inline Limb digitPower(size_t r) { return Limb(1) << r; }
+#else
+const Limb LIMB_MAX = BASE - 1;
+const double LIMB_RADIX = BASE;
+const size_t DECIMAL_GROUP = BASE_LENGTH;
+const Limb DECIMAL_GROUP_POWER = BASE;
+
+inline Limb addCarry(Limb a, Limb b, Limb& carry) {
+  Limb sum = a + b + carry;
+  carry = sum >= BASE;
+  return carry ? sum - BASE : sum;
+}
 
-  void setSign(bool sign) { negative_ = sign; }
+inline Limb subBorrow(Limb a, Limb b, Limb& borrow) {
+  Limb sub = b + borrow;
+  borrow = a < sub;
+  return borrow ? a + BASE - sub : a - sub;
+}
 
-  friend BigInteger operator+(BigInteger lhs, const BigInteger& right);
+// Returns the low limb of a * b + c + carry and leaves the high one in carry.
+inline Limb mulAdd(Limb a, Limb b, Limb c, Limb& carry) {
+  Limb cur = a * b + c + carry;
+  carry = cur / BASE;
+  return cur - carry * BASE;
+}
 
-  friend BigInteger operator-(BigInteger lhs, const BigInteger& rhs);
+// hi * radix + lo as a double-width value.
+inline DoubleLimb wide(Limb hi, Limb lo) { return DoubleLimb(hi) * BASE + lo; }
 
-  BigInteger& operator+=(const BigInteger& other);
+// (hi * radix + lo) / d with hi < d; the remainder goes to rest.
+inline Limb divWide(Limb hi, Limb lo, Limb d, Limb& rest) {
+  if (hi <= (~Limb(0) - lo) / BASE) {
+    Limb cur = hi * BASE + lo;
+    rest = cur % d;
+    return cur / d;
+  }
+  DoubleLimb cur = wide(hi, lo);
+  rest = static_cast<Limb>(cur % d);
+  return static_cast<Limb>(cur / d);
+}
 
-  BigInteger& operator-=(const BigInteger& other);
+// Factor that lifts a nonzero top limb to at least half the radix.
+inline Limb normalizer(Limb top) { return BASE / (top + 1); }
 
-  friend BigInteger operator*(const BigInteger& a, const int64_t n);
+// The radix is RADIX_DIGITS powers of its digit, 10; powers of the digit
+// are limb shifts and a power of ten in the top limb.
+const size_t RADIX_DIGITS = BASE_LENGTH;
 
-  friend BigInteger operator*(const BigInteger& lhs, const BigInteger& rhs);
+// Whether a nonzero c is the digit to some power t.
+inline bool isDigitPower(Limb c, size_t& t) {
+  Limb power = 1;
+  for (t = 0; t < RADIX_DIGITS; ++t, power *= 10) {
+    if (power == c) {
+      return true;
+    }
+  }
+  return false;
+}
 
-  BigInteger& operator*=(const BigInteger& rhs);
+// The digit to the power r < RADIX_DIGITS.
+inline Limb digitPower(size_t r) {
+  Limb power = 1;
+  while (r-- > 0) {
+    power *= 10;
+  }
+  return power;
+}
+#endif
 
-  BigInteger& operator*=(const int64_t number);
+// Division by an invariant 64-bit word through its precomputed reciprocal
+// (Moller and Granlund, "Improved division by invariant integers"): every
+// step costs two multiplications instead of a hardware divide.
+class WordInverse {
+ public:
+  explicit WordInverse(Limb d)
+      : shift_(__builtin_clzll(d)),
+        divisor_(d << shift_),
+        inverse_(static_cast<Limb>(~DoubleLimb(0) / divisor_)) {}
+
+  // (hi * radix + lo) / d with hi < d; the remainder goes to rest.
+  Limb divide(Limb hi, Limb lo, Limb& rest) const {
+    DoubleLimb cur = wide(hi, lo) << shift_;
+    Limb high = static_cast<Limb>(cur >> 64);
+    Limb low = static_cast<Limb>(cur);
+    DoubleLimb estimate = DoubleLimb(inverse_) * high + cur;
+    Limb quotient = static_cast<Limb>(estimate >> 64) + 1;
+    Limb remainder = low - quotient * divisor_;
+    if (remainder > static_cast<Limb>(estimate)) {
+      --quotient;
+      remainder += divisor_;
+    }
+    if (remainder >= divisor_) {
+      ++quotient;
+      remainder -= divisor_;
+    }
+    rest = remainder >> shift_;
+    return quotient;
+  }
 
-  friend BigInteger operator/(const BigInteger& a, const BigInteger& b);
+ private:
+  int shift_;
+  Limb divisor_;  // normalized: the top bit is set
+  Limb inverse_;  // floor((2^128 - 1) / divisor_) - 2^64
+};
 
-  BigInteger& operator/=(const BigInteger& b);
+// Bump allocator for the temporaries of the recursive kernels. Blocks are
+// kept after a Frame is released, so repeated operations reuse them.
+class ScratchArena {
+ public:
+  class Frame {
+   public:
+    explicit Frame(ScratchArena& arena)
+        : arena_(arena), block_(arena.block_), used_(arena.used_) {}
+    Frame(const Frame&) = delete;
+    Frame& operator=(const Frame&) = delete;
+    ~Frame() {
+      arena_.block_ = block_;
+      arena_.used_ = used_;
+    }
 
-  friend BigInteger operator/(BigInteger a, const int64_t& n);
+   private:
+    ScratchArena& arena_;
+    size_t block_;
+    size_t used_;
+  };
 
-  BigInteger& operator/=(const int64_t& n);
+  Limb* alloc(size_t count);
 
-  BigInteger& operator%=(const BigInteger& a);
+  // Makes sure the next `count` limbs come from a single existing block.
+  void reserve(size_t count) {
+    Frame frame(*this);
+    alloc(count);
+  }
 
-  friend BigInteger operator%(const BigInteger& a, const BigInteger& b);
+ private:
+  struct Block {
+    std::unique_ptr<Limb[]> data;
+    size_t size;
+  };
+  static const size_t kMinBlock = 4096;
+
+  std::vector<Block> blocks_;
+  size_t block_ = 0;
+  size_t used_ = 0;
+};
 
-  BigInteger& operator++();
+inline Limb* ScratchArena::alloc(size_t count) {
+  while (block_ < blocks_.size()) {
+    if (blocks_[block_].size - used_ >= count) {
+      Limb* position = blocks_[block_].data.get() + used_;
+      used_ += count;
+      return position;
+    }
+    ++block_;
+    used_ = 0;
+  }
+  size_t size = std::max(
+      count, blocks_.empty() ? kMinBlock : 2 * blocks_.back().size);
+  blocks_.push_back({std::unique_ptr<Limb[]>(new Limb[size]), size});
+  block_ = blocks_.size() - 1;
+  used_ = count;
+  return blocks_.back().data.get();
+}
 
-  BigInteger operator++(int);
+// The arena the kernels draw from on this thread: a long-lived default, or
+// the innermost BigIntegerArena while one is alive.
+inline ScratchArena*& currentScratch() {
+  thread_local ScratchArena fallback;
+  thread_local ScratchArena* current = &fallback;
+  return current;
+}
 
-  BigInteger& operator--();
+inline ScratchArena& scratch() { return *currentScratch(); }
 
-  BigInteger operator--(int);
+// Limb array that keeps up to kInline limbs inside the object and moves to
+// the heap only past that. The top bit of the size word is a spare flag the
+// owner can use (BigInteger keeps its sign there), so the whole thing is four
+// words.
+class LimbVector {
+ public:
+  static const size_t kInline = 3;
 
-  friend std::istream& operator>>(std::istream& in, BigInteger& bi);
+  LimbVector() : size_(0) {}
+  LimbVector(const LimbVector& other) : size_(0) { *this = other; }
+  LimbVector(LimbVector&& other) noexcept : size_(0) {
+    *this = std::move(other);
+  }
+  ~LimbVector() { release(); }
 
-  friend std::ostream& operator<<(std::ostream& out, const BigInteger& bi);
+  LimbVector& operator=(const LimbVector& other) {
+    if (this != &other) {
+      assign(other.data(), other.data() + other.size());
+      setFlag(other.flag());
+    }
+    return *this;
+  }
+
+  LimbVector& operator=(LimbVector&& other) noexcept {
+    if (this == &other) {
+      return *this;
+    }
+    if (!other.isInline()) {
+      release();
+      heap_ = other.heap_;
+      size_ = other.size_;
+      other.size_ = 0;
+      return *this;
+    }
+    assign(other.data(), other.data() + other.size());
+    setFlag(other.flag());
+    return *this;
+  }
 
-  void pushOverflow();
+  size_t size() const { return size_ & ~(kFlag | kHeap); }
+  size_t capacity() const { return isInline() ? kInline : heap_.capacity; }
+  bool flag() const { return size_ & kFlag; }
+  void setFlag(bool flag) { size_ = (size_ & ~kFlag) | (flag ? kFlag : 0); }
+
+  Limb* data() { return isInline() ? inline_ : heap_.data; }
+  const Limb* data() const { return isInline() ? inline_ : heap_.data; }
+  Limb& operator[](size_t index) { return data()[index]; }
+  Limb operator[](size_t index) const { return data()[index]; }
+  Limb* begin() { return data(); }
+  Limb* end() { return data() + size(); }
+  const Limb* begin() const { return data(); }
+  const Limb* end() const { return data() + size(); }
+
+  void reserve(size_t count) {
+    if (count <= capacity()) {
+      return;
+    }
+    size_t grown = std::max(count, 2 * capacity());
+    size_t used = size();
+    Limb* fresh = new Limb[grown];
+    std::copy(begin(), end(), fresh);
+    release();
+    heap_ = {fresh, grown};
+    size_ |= kHeap | used;
+  }
 
-  void trimLeft() {
-    size_ = digits_.size();
-    while (size_ > 1 && digits_[size_ - 1] == 0) {
-      --size_;
+  void resize(size_t count, Limb value = 0) {
+    reserve(count);
+    if (count > size()) {
+      std::fill(end(), data() + count, value);
     }
-    digits_.resize(size_);
+    size_ = (size_ & (kFlag | kHeap)) | count;
   }
 
-  void shiftLeft();
+  void push_back(Limb value) {
+    reserve(size() + 1);
+    data()[size()] = value;
+    ++size_;
+  }
+
+  void assign(const Limb* first, const Limb* last) {
+    resize(0);
+    reserve(last - first);
+    std::copy(first, last, data());
+    size_ += last - first;
+  }
+
+  void clear() { resize(0); }
+
+ private:
+  static const size_t kFlag = size_t(1) << 63;
+  static const size_t kHeap = size_t(1) << 62;
+
+  bool isInline() const { return !(size_ & kHeap); }
+
+  void release() {
+    if (!isInline()) {
+      delete[] heap_.data;
+    }
+    size_ &= kFlag;
+  }
+
+  struct Heap {
+    Limb* data;
+    size_t capacity;
+  };
+
+  size_t size_;  // limb count, plus the kFlag and kHeap bits
+  union {
+    Limb inline_[kInline];
+    Heap heap_;
+  };
 };
 
-std::string numToString(u_int64_t number, bool fixW) {
-  std::string tmp = std::to_string(number);
-  if ((tmp.length() < BASE_LENGTH) && fixW) {
-    tmp = std::string(BASE_LENGTH - tmp.length(), '0') + tmp;
+inline size_t trimmed(const Limb* a, size_t n) {
+  while (n > 0 && a[n - 1] == 0) {
+    --n;
   }
-  return tmp;
+  return n;
 }
 
-static std::string decPow(int64_t pow) {
-  if (pow < 0) {
-    return "0";
+// a[0..n) += b[0..m), m <= n; returns the carry out of a[n - 1].
+inline Limb addTo(Limb* a, size_t n, const Limb* b, size_t m) {
+  Limb carry = 0;
+  size_t i = 0;
+  for (; i < m; ++i) {
+    a[i] = addCarry(a[i], b[i], carry);
+  }
+  for (; carry && i < n; ++i) {
+    a[i] = addCarry(a[i], 0, carry);
   }
-  std::string t = "1";
-  t += std::string(pow, '0');
-  return t;
+  return carry;
 }
 
-BigInteger::BigInteger(int64_t number) {  // bigint from number
-  digits_.clear();
-  if (number < 0) {
-    negative_ = true;
-    number *= -1;
-  } else {
-    negative_ = false;
+// a[0..n) -= b[0..m), m <= n; returns the borrow out of a[n - 1].
+inline Limb subFrom(Limb* a, size_t n, const Limb* b, size_t m) {
+  Limb borrow = 0;
+  size_t i = 0;
+  for (; i < m; ++i) {
+    a[i] = subBorrow(a[i], b[i], borrow);
   }
-  size_t next = 0;
-  while (number && next < SIZE) {
-    digits_.push_back(number % BASE);
-    number /= BASE;
+  for (; borrow && i < n; ++i) {
+    a[i] = subBorrow(a[i], 0, borrow);
   }
-  size_ = digits_.size();
-  if (size_ == 0) {
-    digits_.push_back(0);
+  return borrow;
+}
+
+// out[0..n) = a[0..n) + b[0..m), m <= n; returns the carry. `out` may be
+// one of the operands.
+inline Limb addLimbs(const Limb* a, size_t n, const Limb* b, size_t m,
+                     Limb* out) {
+  Limb carry = 0;
+  size_t i = 0;
+  for (; i < m; ++i) {
+    out[i] = addCarry(a[i], b[i], carry);
   }
+  for (; i < n; ++i) {
+    out[i] = addCarry(a[i], 0, carry);
+  }
+  return carry;
 }
 
-BigInteger::BigInteger(int64_t number, size_t len) {
-  digits_.resize(len, number);
-  size_ = len;
-  if (number == 0) {
-    size_ = 1;
+// out[0..n) = a[0..n) - b[0..m), m <= n and a >= b. `out` may be one of the
+// operands.
+inline void subLimbs(const Limb* a, size_t n, const Limb* b, size_t m,
+                     Limb* out) {
+  Limb borrow = 0;
+  size_t i = 0;
+  for (; i < m; ++i) {
+    out[i] = subBorrow(a[i], b[i], borrow);
+  }
+  for (; i < n; ++i) {
+    out[i] = subBorrow(a[i], 0, borrow);
   }
-  negative_ = false;
 }
 
-BigInteger::BigInteger(std::string str)
-    : digits_((str.size() - (str[0] == '-')) / BASE_LENGTH +
-              ((str.size() - (str[0] == '-')) % BASE_LENGTH >
-               0)) {  // bigint from string
-  negative_ = (str[0] == '-');
-  size_ = digits_.size();
-  std::reverse(str.begin(), str.end());
-  u_int64_t buffer = 0;
-  size_t pos = 0;
-  size_t power = 1;
-  for (size_t i = 0; i < str.length(); ++i) {
-    if ((i % BASE_LENGTH == 0) && i > 0) {
-      digits_[pos++] = buffer;
-      buffer = 0;
-      power = 1;
+inline int compare(const Limb* a, size_t n, const Limb* b, size_t m) {
+  n = trimmed(a, n);
+  m = trimmed(b, m);
+  if (n != m) {
+    return n < m ? -1 : 1;
+  }
+  for (size_t i = n; i > 0; --i) {
+    if (a[i - 1] != b[i - 1]) {
+      return a[i - 1] < b[i - 1] ? -1 : 1;
     }
-    if (str[i] != '-') {
-      buffer += (str[i] - '0') * power;
-      power *= 10;
+  }
+  return 0;
+}
+
+// out[0..n) = a[0..n) * w for a single limb w; returns the carry limb.
+inline Limb mulWord(const Limb* a, size_t n, Limb w, Limb* out) {
+  Limb carry = 0;
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = mulAdd(a[i], w, 0, carry);
+  }
+  return carry;
+}
+
+// a[0..n) = radix^n - a[0..n): the magnitude of a subtraction that wrapped.
+inline void negateLimbs(Limb* a, size_t n) {
+  Limb borrow = 0;
+  for (size_t i = 0; i < n; ++i) {
+    a[i] = subBorrow(0, a[i], borrow);
+  }
+}
+
+// a[0..n) += b[0..m) * w, m < n; returns the carry out of a[n - 1].
+inline Limb addMulWord(Limb* a, size_t n, const Limb* b, size_t m, Limb w) {
+  Limb carry = 0;
+  for (size_t i = 0; i < m; ++i) {
+    a[i] = mulAdd(b[i], w, a[i], carry);
+  }
+  return addTo(a + m, n - m, &carry, 1);
+}
+
+// a[0..n) -= b[0..m) * w, m < n; returns the borrow out of a[n - 1].
+inline Limb subMulWord(Limb* a, size_t n, const Limb* b, size_t m, Limb w) {
+  Limb carry = 0;
+  Limb borrow = 0;
+  for (size_t i = 0; i < m; ++i) {
+    Limb product = mulAdd(b[i], w, 0, carry);
+    a[i] = subBorrow(a[i], product, borrow);
+  }
+  a[m] = subBorrow(a[m], carry, borrow);
+  for (size_t i = m + 1; borrow && i < n; ++i) {
+    a[i] = subBorrow(a[i], 0, borrow);
+  }
+  return borrow;
+}
+
+// a[0..n) /= d for a nonzero word d; returns the remainder.
+inline Limb divWord(Limb* a, size_t n, const WordInverse& d) {
+  Limb rest = 0;
+  for (size_t i = n; i > 0; --i) {
+    a[i - 1] = d.divide(rest, a[i - 1], rest);
+  }
+  return rest;
+}
+
+inline Limb divWord(Limb* a, size_t n, Limb d) {
+  if (n == 1) {
+    Limb rest = 0;
+    a[0] = divWide(0, a[0], d, rest);
+    return rest;
+  }
+  return divWord(a, n, WordInverse(d));
+}
+
+// a[0..n) % d for a nonzero word d.
+inline Limb modWord(const Limb* a, size_t n, const WordInverse& d) {
+  Limb rest = 0;
+  for (size_t i = n; i > 0; --i) {
+    d.divide(rest, a[i - 1], rest);
+  }
+  return rest;
+}
+
+#ifdef BIGINT_BINARY_LIMBS
+// out[0..n + m) = a[0..n) * b[0..m), m <= n.
+inline void mulSchoolbook(const Limb* a, size_t n, const Limb* b, size_t m,
+                          Limb* out) {
+  std::fill(out, out + n, 0);
+  for (size_t i = 0; i < m; ++i) {
+    Limb factor = b[i];
+    Limb* row = out + i;
+    Limb carry = 0;
+    for (size_t j = 0; j < n; ++j) {
+      row[j] = mulAdd(a[j], factor, row[j], carry);
     }
+    row[n] = carry;
   }
-  if (buffer) {
-    digits_[pos] = buffer;
-    buffer = 0;
+}
+
+// out[0..2n) = the cross products a[i] * a[j] for i < j at offset i + j.
+inline void sqrCross(const Limb* a, size_t n, Limb* out) {
+  std::fill(out, out + 2 * n, 0);
+  for (size_t i = 0; i + 1 < n; ++i) {
+    Limb factor = a[i];
+    Limb* row = out + i;
+    Limb carry = 0;
+    for (size_t j = i + 1; j < n; ++j) {
+      row[j] = mulAdd(a[j], factor, row[j], carry);
+    }
+    row[n] = carry;
+  }
+}
+#else
+// Limbs below BASE absorb this many rows of products below BASE^2 before a
+// 64-bit accumulator can overflow, so carries are only resolved that often.
+const size_t kDeferredRows = 18;
+
+// Brings a[from..) back below BASE; stops once the carry dies out past `to`.
+inline void propagate(Limb* a, size_t from, size_t to) {
+  Limb carry = 0;
+  size_t i = from;
+  for (; i < to || carry; ++i) {
+    Limb cur = a[i] + carry;
+    carry = cur / BASE;
+    a[i] = cur - carry * BASE;
+  }
+}
+
+// out[0..n + m) = a[0..n) * b[0..m), m <= n.
+inline void mulSchoolbook(const Limb* a, size_t n, const Limb* b, size_t m,
+                          Limb* out) {
+  std::fill(out, out + n + m, 0);
+  for (size_t i = 0; i < m; ++i) {
+    Limb factor = b[i];
+    Limb* row = out + i;
+    for (size_t j = 0; j < n; ++j) {
+      row[j] += a[j] * factor;
+    }
+    if ((i + 1) % kDeferredRows == 0) {
+      propagate(out, i + 1 - kDeferredRows, i + n);
+    }
+  }
+  propagate(out, m - m % kDeferredRows, n + m);
+}
+
+// out[0..2n) = the cross products a[i] * a[j] for i < j at offset i + j.
+inline void sqrCross(const Limb* a, size_t n, Limb* out) {
+  std::fill(out, out + 2 * n, 0);
+  for (size_t i = 0; i + 1 < n; ++i) {
+    Limb factor = a[i];
+    Limb* row = out + i;
+    for (size_t j = i + 1; j < n; ++j) {
+      row[j] += a[j] * factor;
+    }
+    if ((i + 1) % kDeferredRows == 0) {
+      propagate(out, i + 1 - kDeferredRows, i + n);
+    }
+  }
+  propagate(out, 0, 2 * n);
+}
+#endif
+
+// out[0..2n) = a[0..n)^2: each cross product once, doubled, plus the squares
+// on the diagonal.
+inline void sqrSchoolbook(const Limb* a, size_t n, Limb* out) {
+  sqrCross(a, n, out);
+  addLimbs(out, 2 * n, out, 2 * n, out);
+  Limb carry = 0;
+  for (size_t i = 0; i < n; ++i) {
+    Limb high = 0;
+    Limb low = mulAdd(a[i], a[i], 0, high);
+    out[2 * i] = addCarry(out[2 * i], low, carry);
+    out[2 * i + 1] = addCarry(out[2 * i + 1], high, carry);
+  }
+}
+
+inline void mul(const Limb* a, size_t n, const Limb* b, size_t m, Limb* out);
+
+// Persistent helper threads for Fork. They start on first use and sleep
+// between tasks, so each keeps its scratch arena warm across
+// multiplications. The pool joins them when the program exits.
+class HelperPool {
+ public:
+  struct Job {
+    std::function<void()> task;
+    std::atomic<bool> claimed{false};
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool done = false;
+    std::exception_ptr error;
+
+    // Runs the task unless another thread already took it.
+    bool tryRun() {
+      if (claimed.exchange(true)) {
+        return false;
+      }
+      try {
+        task();
+      } catch (...) {
+        error = std::current_exception();
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+      }
+      finished.notify_all();
+      return true;
+    }
+
+    void wait() {
+      std::unique_lock<std::mutex> lock(mutex);
+      finished.wait(lock, [this] { return done; });
+    }
+  };
+
+  static HelperPool& instance() {
+    static HelperPool pool;
+    return pool;
+  }
+
+  HelperPool(const HelperPool&) = delete;
+  HelperPool& operator=(const HelperPool&) = delete;
+  ~HelperPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    ready_.notify_all();
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  // Queues the job, first growing the pool to `helpers` threads. Throws if
+  // a thread cannot be started; the job is not queued then.
+  void submit(const std::shared_ptr<Job>& job, size_t helpers) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (threads_.size() < helpers) {
+      threads_.reserve(helpers);
+      while (threads_.size() < helpers) {
+        threads_.emplace_back([this] { work(); });
+      }
+    }
+    queue_.push_back(job);
+    ready_.notify_one();
+  }
+
+ private:
+  HelperPool() = default;
+
+  void work() {
+    while (true) {
+      std::shared_ptr<Job> job;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          return;
+        }
+        job = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      job->tryRun();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<std::shared_ptr<Job>> queue_;
+  std::vector<std::thread> threads_;
+  bool stop_ = false;
+};
+
+// Fork-join for the independent subproducts of a large multiplication. The
+// task goes to the helper pool while fewer than mul_threads - 1 tasks are
+// out anywhere in the process, and runs inline otherwise. A task no helper
+// has started by join() runs on the joining thread, so nested forks never
+// wait on a queue.
+class Fork {
+ public:
+  template <class Task>
+  Fork(size_t limbs, Task task) {
+    if (limbs >= BigIntegerTuning::parallel_threshold && reserveWorker()) {
+      try {
+        job_ = std::make_shared<HelperPool::Job>();
+        job_->task = task;
+        HelperPool::instance().submit(job_, BigIntegerTuning::mul_threads - 1);
+        return;
+      } catch (...) {
+        // No thread or no memory for the hand-off: give the slot back.
+        job_.reset();
+        busyWorkers().fetch_sub(1);
+      }
+    }
+    task();
+  }
+  Fork(const Fork&) = delete;
+  Fork& operator=(const Fork&) = delete;
+  ~Fork() {
+    if (job_) {
+      finish(*job_);
+    }
+  }
+
+  void join() {
+    if (job_) {
+      std::shared_ptr<HelperPool::Job> job = std::move(job_);
+      finish(*job);
+      if (job->error) {
+        std::rethrow_exception(job->error);
+      }
+    }
+  }
+
+ private:
+  // Tasks handed to the pool and not yet joined, across all multiplications.
+  static std::atomic<size_t>& busyWorkers() {
+    static std::atomic<size_t> busy{0};
+    return busy;
+  }
+
+  static bool reserveWorker() {
+    std::atomic<size_t>& busy = busyWorkers();
+    size_t current = busy.load();
+    while (current + 1 < BigIntegerTuning::mul_threads) {
+      if (busy.compare_exchange_weak(current, current + 1)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static void finish(HelperPool::Job& job) {
+    if (!job.tryRun()) {
+      job.wait();
+    }
+    busyWorkers().fetch_sub(1);
+  }
+
+  std::shared_ptr<HelperPool::Job> job_;
+};
+
+// Karatsuba step for m <= n < 2m: splitting both operands at k = n / 2,
+// a * b = z2 * B^2k + z1 * B^k + z0 with three half-size products, where B
+// is the limb radix.
+inline void mulKaratsuba(const Limb* a, size_t n, const Limb* b, size_t m,
+                         Limb* out) {
+  size_t k = n / 2;
+  size_t ha = n - k;
+  size_t hb = m - k;
+  ScratchArena::Frame frame(scratch());
+  size_t la = ha + 1;
+  size_t lb = std::max(k, hb) + 1;
+  Limb* sa = scratch().alloc(la);
+  Limb* z1 = scratch().alloc(la + lb);
+  sa[ha] = addLimbs(a + k, ha, a, k, sa);
+  // Squares pass the same sum twice so the middle product squares as well.
+  Limb* sb = a == b && n == m ? sa : scratch().alloc(lb);
+  if (sb == sa) {
+    lb = la;
+  } else if (hb >= k) {
+    sb[hb] = addLimbs(b + k, hb, b, k, sb);
+  } else {
+    sb[k] = addLimbs(b, k, b + k, hb, sb);
+  }
+  la = trimmed(sa, la);
+  lb = trimmed(sb, lb);
+  Fork low(m, [=] { mul(a, k, b, k, out); });
+  mul(a + k, ha, b + k, hb, out + 2 * k);
+  mul(sa, la, sb, lb, z1);
+  low.join();
+  size_t lz = la + lb;
+  subFrom(z1, lz, out, trimmed(out, 2 * k));
+  subFrom(z1, lz, out + 2 * k, trimmed(out + 2 * k, ha + hb));
+  addTo(out + k, n + m - k, z1, std::min(trimmed(z1, lz), n + m - k));
+}
+
+// Signed value over caller-owned limbs, used by the Toom interpolation.
+struct SignedSpan {
+  Limb* data;
+  size_t size;
+  bool negative;
+};
+
+// out = x + y, or x - y when `subtract` is set. `out` may alias x or y and
+// needs room for max(x.size, y.size) + 1 limbs.
+inline void addSigned(const SignedSpan& x, const SignedSpan& y, bool subtract,
+                      SignedSpan& out) {
+  bool y_negative = y.negative ^ subtract;
+  bool x_larger = compare(x.data, x.size, y.data, y.size) >= 0;
+  const SignedSpan& big = x_larger ? x : y;
+  const SignedSpan& small = x_larger ? y : x;
+  bool negative = x_larger ? x.negative : y_negative;
+  size_t size = big.size;
+  if (x.negative == y_negative) {
+    out.data[size] = addLimbs(big.data, big.size, small.data, small.size,
+                              out.data);
+    ++size;
+  } else {
+    subLimbs(big.data, big.size, small.data, small.size, out.data);
+  }
+  out.size = trimmed(out.data, size);
+  out.negative = out.size > 0 && negative;
+}
+
+// Values of x0 + x1 t + x2 t^2 at t = 1, -1, -2, where x = x2:x1:x0 is split
+// into k-limb parts; every output needs k + 2 limbs.
+inline void toomEvaluate(const Limb* x, size_t k, size_t n2, SignedSpan& v1,
+                         SignedSpan& vm1, SignedSpan& vm2) {
+  SignedSpan x0{const_cast<Limb*>(x), trimmed(x, k), false};
+  SignedSpan x1{const_cast<Limb*>(x + k), trimmed(x + k, k), false};
+  SignedSpan x2{const_cast<Limb*>(x + 2 * k), trimmed(x + 2 * k, n2), false};
+  addSigned(x0, x2, false, v1);
+  addSigned(v1, x1, true, vm1);
+  addSigned(v1, x1, false, v1);
+  addSigned(vm1, x2, false, vm2);
+  addSigned(vm2, vm2, false, vm2);
+  addSigned(vm2, x0, true, vm2);
+}
+
+// Toom-3 step for balanced operands: both are split into three k-limb parts,
+// the product polynomial is evaluated at 0, 1, -1, -2 and infinity with five
+// recursive products and interpolated back (Bodrato's sequence, exact
+// divisions by 2 and 3).
+inline void mulToom3(const Limb* a, size_t n, const Limb* b, size_t m,
+                     Limb* out) {
+  size_t k = (n + 2) / 3;
+  size_t na2 = n - 2 * k;
+  size_t nb2 = m - 2 * k;
+  ScratchArena& arena = scratch();
+  ScratchArena::Frame frame(arena);
+  size_t eval = k + 2;
+  size_t coef = 2 * eval + 1;
+  SignedSpan a1{arena.alloc(eval), 0, false};
+  SignedSpan am1{arena.alloc(eval), 0, false};
+  SignedSpan am2{arena.alloc(eval), 0, false};
+  toomEvaluate(a, k, na2, a1, am1, am2);
+  // Squares reuse the evaluations of a, so every product below squares too.
+  SignedSpan b1 = a1, bm1 = am1, bm2 = am2;
+  if (a != b || n != m) {
+    b1 = {arena.alloc(eval), 0, false};
+    bm1 = {arena.alloc(eval), 0, false};
+    bm2 = {arena.alloc(eval), 0, false};
+    toomEvaluate(b, k, nb2, b1, bm1, bm2);
+  }
+
+  SignedSpan r1{arena.alloc(coef), 0, false};
+  SignedSpan rm1{arena.alloc(coef), 0, false};
+  SignedSpan rm2{arena.alloc(coef), 0, false};
+  auto product = [](const SignedSpan& x, const SignedSpan& y, SignedSpan& r) {
+    mul(x.data, x.size, y.data, y.size, r.data);
+    r.size = trimmed(r.data, x.size + y.size);
+    r.negative = r.size > 0 && (x.negative ^ y.negative);
+  };
+  Fork one(m, [&] { product(a1, b1, r1); });
+  Fork minus_one(m, [&] { product(am1, bm1, rm1); });
+  Fork minus_two(m, [&] { product(am2, bm2, rm2); });
+  mul(a, k, b, k, out);
+  mul(a + 2 * k, na2, b + 2 * k, nb2, out + 4 * k);
+  one.join();
+  minus_one.join();
+  minus_two.join();
+  SignedSpan r0{out, trimmed(out, 2 * k), false};
+  SignedSpan rinf{out + 4 * k, trimmed(out + 4 * k, na2 + nb2), false};
+
+  addSigned(rm2, r1, true, rm2);
+  divWord(rm2.data, rm2.size, 3);
+  rm2.size = trimmed(rm2.data, rm2.size);
+  addSigned(r1, rm1, true, r1);
+  divWord(r1.data, r1.size, 2);
+  r1.size = trimmed(r1.data, r1.size);
+  addSigned(rm1, r0, true, rm1);
+  addSigned(rm1, rm2, true, rm2);
+  divWord(rm2.data, rm2.size, 2);
+  rm2.size = trimmed(rm2.data, rm2.size);
+  addSigned(rm2, rinf, false, rm2);
+  addSigned(rm2, rinf, false, rm2);
+  addSigned(rm1, r1, false, rm1);
+  addSigned(rm1, rinf, true, rm1);
+  addSigned(r1, rm2, true, r1);
+
+  // r1, rm1 and rm2 now hold the coefficients of t, t^2 and t^3.
+  std::fill(out + 2 * k, out + 4 * k, 0);
+  size_t total = n + m;
+  addTo(out + k, total - k, r1.data, r1.size);
+  addTo(out + 2 * k, total - 2 * k, rm1.data, rm1.size);
+  addTo(out + 3 * k, total - 3 * k, rm2.data, rm2.size);
+}
+
+// The transforms run over pieces small enough that a convolution of 2^22 of
+// them stays below the product of the three primes: whole decimal limbs, or
+// halves of binary ones.
+#ifdef BIGINT_BINARY_LIMBS
+const size_t kNttPiecesPerLimb = 2;
+
+inline Limb nttPiece(const Limb* a, size_t i) {
+  return (a[i / 2] >> (32 * (i % 2))) & 0xffffffff;
+}
+#else
+const size_t kNttPiecesPerLimb = 1;
+
+inline Limb nttPiece(const Limb* a, size_t i) { return a[i]; }
+#endif
+
+// Number-theoretic transform modulo a prime P = c * 2^k + 1 with primitive
+// root G; lengths are powers of two up to 2^k.
+template <u_int32_t P, u_int32_t G>
+struct NttPrime {
+  static const u_int32_t kMod = P;
+
+  static u_int32_t power(u_int64_t base, u_int64_t exp) {
+    u_int64_t result = 1;
+    base %= P;
+    while (exp > 0) {
+      if (exp & 1) {
+        result = result * base % P;
+      }
+      base = base * base % P;
+      exp >>= 1;
+    }
+    return result;
+  }
+
+  static void transform(u_int32_t* a, size_t len, bool inverse,
+                        std::vector<u_int32_t>& roots) {
+    for (size_t i = 1, j = 0; i < len; ++i) {
+      size_t bit = len >> 1;
+      for (; j & bit; bit >>= 1) {
+        j ^= bit;
+      }
+      j ^= bit;
+      if (i < j) {
+        std::swap(a[i], a[j]);
+      }
+    }
+    roots.resize(len / 2);
+    for (size_t half = 1; half < len; half <<= 1) {
+      u_int64_t step = power(G, (P - 1) / (2 * half));
+      if (inverse) {
+        step = power(step, P - 2);
+      }
+      roots[0] = 1;
+      for (size_t j = 1; j < half; ++j) {
+        roots[j] = roots[j - 1] * step % P;
+      }
+      for (size_t i = 0; i < len; i += 2 * half) {
+        u_int32_t* lo = a + i;
+        u_int32_t* hi = a + i + half;
+        for (size_t j = 0; j < half; ++j) {
+          u_int32_t u = lo[j];
+          u_int32_t v = static_cast<u_int64_t>(hi[j]) * roots[j] % P;
+          lo[j] = u + v >= P ? u + v - P : u + v;
+          hi[j] = u >= v ? u - v : u + P - v;
+        }
+      }
+    }
+    if (inverse) {
+      u_int64_t scale = power(len, P - 2);
+      for (size_t i = 0; i < len; ++i) {
+        a[i] = a[i] * scale % P;
+      }
+    }
+  }
+
+  // product[0..len) = cyclic convolution of the pieces of a[0..n) and
+  // b[0..m) mod P.
+  static void convolve(const Limb* a, size_t n, const Limb* b, size_t m,
+                       size_t len, std::vector<u_int32_t>& product,
+                       std::vector<u_int32_t>& buffer,
+                       std::vector<u_int32_t>& roots) {
+    product.assign(len, 0);
+    for (size_t i = 0; i < n * kNttPiecesPerLimb; ++i) {
+      product[i] = nttPiece(a, i) % P;
+    }
+    transform(product.data(), len, false, roots);
+    // A square needs only the one forward transform.
+    const std::vector<u_int32_t>* other = &product;
+    if (a != b || n != m) {
+      buffer.assign(len, 0);
+      for (size_t i = 0; i < m * kNttPiecesPerLimb; ++i) {
+        buffer[i] = nttPiece(b, i) % P;
+      }
+      transform(buffer.data(), len, false, roots);
+      other = &buffer;
+    }
+    for (size_t i = 0; i < len; ++i) {
+      product[i] = static_cast<u_int64_t>(product[i]) * (*other)[i] % P;
+    }
+    transform(product.data(), len, true, roots);
+  }
+};
+
+using NttPrime1 = NttPrime<998244353, 3>;
+using NttPrime2 = NttPrime<167772161, 3>;
+using NttPrime3 = NttPrime<469762049, 3>;
+
+// Longest transform all three primes support.
+const size_t kNttMaxLength = size_t(1) << 23;
+
+// Convolves the pieces modulo three primes and rebuilds every coefficient
+// (below min(n, m) * 2^64, under P1 * P2 * P3) with Garner's CRT,
+// propagating carries on the fly.
+inline void mulNtt(const Limb* a, size_t n, const Limb* b, size_t m,
+                   Limb* out) {
+  size_t pieces = (n + m) * kNttPiecesPerLimb;
+  size_t len = 1;
+  while (len < pieces - 1) {
+    len <<= 1;
+  }
+  std::vector<u_int32_t> r1, r2, r3;
+  auto convolve = [&](auto prime, std::vector<u_int32_t>& product) {
+    std::vector<u_int32_t> buffer, roots;
+    decltype(prime)::convolve(a, n, b, m, len, product, buffer, roots);
+  };
+  Fork second(m, [&] { convolve(NttPrime2(), r2); });
+  Fork third(m, [&] { convolve(NttPrime3(), r3); });
+  convolve(NttPrime1(), r1);
+  second.join();
+  third.join();
+
+  const u_int64_t p1 = NttPrime1::kMod;
+  const u_int64_t p2 = NttPrime2::kMod;
+  const u_int64_t p3 = NttPrime3::kMod;
+  const u_int64_t inv_p1 = NttPrime2::power(p1, p2 - 2);
+  const u_int64_t inv_p1p2 = NttPrime3::power(p1 * p2 % p3, p3 - 2);
+  // Coefficient i is x1 + p1 * y with y = x2 + p2 * x3, x1 < p1, x2 < p2,
+  // x3 < p3.
+  auto garner = [&](size_t i, u_int64_t& y) {
+    u_int64_t x1 = r1[i];
+    u_int64_t x2 = (r2[i] + p2 - x1 % p2) % p2 * inv_p1 % p2;
+    u_int64_t low = (x1 + p1 * x2) % p3;
+    u_int64_t x3 = (r3[i] + p3 - low) % p3 * inv_p1p2 % p3;
+    y = x2 + p2 * x3;
+    return x1;
+  };
+#ifdef BIGINT_BINARY_LIMBS
+  std::fill(out, out + n + m, 0);
+  DoubleLimb carry = 0;
+  for (size_t i = 0; i < pieces; ++i) {
+    if (i < pieces - 1) {
+      u_int64_t y = 0;
+      u_int64_t x1 = garner(i, y);
+      carry += x1 + DoubleLimb(p1) * y;
+    }
+    out[i / 2] |= (static_cast<Limb>(carry) & 0xffffffff) << (32 * (i % 2));
+    carry >>= 32;
+  }
+#else
+  u_int64_t carry = 0;
+  for (size_t i = 0; i < pieces; ++i) {
+    u_int64_t cur = carry;
+    carry = 0;
+    if (i < pieces - 1) {
+      u_int64_t y = 0;
+      cur += garner(i, y);
+      cur += p1 * (y % BASE);
+      carry = p1 * (y / BASE);
+    }
+    carry += cur / BASE;
+    out[i] = cur % BASE;
+  }
+#endif
+}
+
+// out[0..n + m) = a[0..n) * b[0..m). `out` must not overlap the operands;
+// passing the same span twice takes the squaring paths.
+inline void mul(const Limb* a, size_t n, const Limb* b, size_t m, Limb* out) {
+  if (n < m) {
+    std::swap(a, b);
+    std::swap(n, m);
+  }
+  if (m == 0) {
+    std::fill(out, out + n, 0);
+    return;
+  }
+  if (m < std::max<size_t>(BigIntegerTuning::karatsuba_threshold, 2)) {
+    if (a == b && n == m && n >= BigIntegerTuning::square_threshold) {
+      sqrSchoolbook(a, n, out);
+    } else {
+      mulSchoolbook(a, n, b, m, out);
+    }
+    return;
+  }
+  if (m >= BigIntegerTuning::ntt_threshold &&
+      (n + m) * kNttPiecesPerLimb <= kNttMaxLength) {
+    mulNtt(a, n, b, m, out);
+    return;
+  }
+  if (n < 2 * m) {
+    if (m >= BigIntegerTuning::toom3_threshold && m > 2 * ((n + 2) / 3)) {
+      mulToom3(a, n, b, m, out);
+    } else {
+      mulKaratsuba(a, n, b, m, out);
+    }
+    return;
+  }
+  // Unbalanced operands: multiply b by m-limb slices of a.
+  mul(a, m, b, m, out);
+  std::fill(out + 2 * m, out + n + m, 0);
+  ScratchArena::Frame frame(scratch());
+  Limb* slice = scratch().alloc(2 * m);
+  for (size_t offset = m; offset < n; offset += m) {
+    size_t len = std::min(m, n - offset);
+    mul(a + offset, len, b, m, slice);
+    addTo(out + offset, n + m - offset, slice, len + m);
+  }
+}
+
+
+// Knuth's Algorithm D on normalized operands: u[0..n] (with a spare top
+// limb) is replaced by its remainder and q[0..n - m] receives the quotient.
+// v[m - 1] must be at least half the radix and m >= 2.
+inline void divKnuth(Limb* u, size_t n, const Limb* v, size_t m, Limb* q) {
+  Limb v1 = v[m - 1];
+  Limb v2 = v[m - 2];
+  WordInverse top(v1);
+  for (size_t j = n - m + 1; j > 0; --j) {
+    Limb* window = u + j - 1;
+    Limb qhat;
+    Limb rhat;
+    Limb overflow = 0;
+    if (window[m] >= v1) {
+      qhat = LIMB_MAX;
+      rhat = addCarry(window[m - 1], v1, overflow);
+    } else {
+      qhat = top.divide(window[m], window[m - 1], rhat);
+    }
+    // qhat is at most two too large; the top three limbs settle most cases.
+    while (!overflow) {
+      Limb high = 0;
+      Limb low = mulAdd(qhat, v2, 0, high);
+      if (high < rhat || (high == rhat && low <= window[m - 2])) {
+        break;
+      }
+      --qhat;
+      rhat = addCarry(rhat, v1, overflow);
+    }
+    if (subMulWord(window, m + 1, v, m, qhat)) {
+      --qhat;
+      addTo(window, m + 1, v, m);
+    }
+    if (q) {
+      q[j - 1] = qhat;
+    }
+  }
+}
+
+inline void div2n1n(Limb* u, const Limb* v, size_t n, Limb* q);
+
+// Burnikel-Ziegler 3n/2n step for u[0..3k) < B^k * v with v[0..2k)
+// normalized: q[0..k) = u / v and the remainder is left in u[0..2k).
+inline void div3n2n(Limb* u, const Limb* v, size_t k, Limb* q) {
+  const Limb* v1 = v + k;
+  if (compare(u + 2 * k, k, v1, k) < 0) {
+    div2n1n(u + k, v1, k, q);
+  } else {
+    // q = B^k - 1 and the partial remainder is [u2 u1] - B^k * v1 + v1.
+    std::fill(q, q + k, LIMB_MAX);
+    subFrom(u + 2 * k, k, v1, k);
+    addTo(u + k, 2 * k, v1, k);
+  }
+  ScratchArena& arena = scratch();
+  ScratchArena::Frame frame(arena);
+  Limb* product = arena.alloc(2 * k);
+  mul(q, k, v, k, product);
+  Limb borrow = subFrom(u, 3 * k, product, 2 * k);
+  // q overshoots by at most two; the add-backs cancel the borrow.
+  const Limb one = 1;
+  while (borrow) {
+    borrow -= addTo(u, 3 * k, v, 2 * k);
+    subFrom(q, k, &one, 1);
+  }
+}
+
+// Burnikel-Ziegler 2n/1n step for u[0..2n) < B^n * v with v[0..n)
+// normalized: q[0..n) = u / v and the remainder is left in u[0..n).
+inline void div2n1n(Limb* u, const Limb* v, size_t n, Limb* q) {
+  if (n % 2 || n < std::max<size_t>(BigIntegerTuning::bz_threshold, 4)) {
+    divKnuth(u, 2 * n - 1, v, n, q);
+    return;
+  }
+  size_t k = n / 2;
+  div3n2n(u + k, v, k, q + k);
+  div3n2n(u, v, k, q);
+}
+
+// Recursive division: the divisor is normalized and padded with low zero
+// limbs to j * 2^s limbs (j below the threshold), then the dividend is
+// consumed one such block at a time by div2n1n.
+inline void divBurnikelZiegler(const Limb* u, size_t n, const Limb* v,
+                               size_t m, Limb* q, Limb* r) {
+  size_t limit = std::max<size_t>(BigIntegerTuning::bz_threshold, 4);
+  size_t levels = 0;
+  while (((m - 1) >> levels) + 1 > limit) {
+    ++levels;
+  }
+  size_t block = (((m - 1) >> levels) + 1) << levels;
+  size_t shift = block - m;
+  size_t blocks = std::max<size_t>((n + shift + 1) / block + 1, 2);
+
+  ScratchArena& arena = scratch();
+  ScratchArena::Frame frame(arena);
+  Limb factor = normalizer(v[m - 1]);
+  Limb* vn = arena.alloc(block);
+  std::fill(vn, vn + shift, 0);
+  mulWord(v, m, factor, vn + shift);
+  Limb* un = arena.alloc(blocks * block);
+  std::fill(un, un + blocks * block, 0);
+  un[shift + n] = mulWord(u, n, factor, un + shift);
+  Limb* qn = arena.alloc((blocks - 1) * block);
+  for (size_t i = blocks - 1; i > 0; --i) {
+    div2n1n(un + (i - 1) * block, vn, block, qn + (i - 1) * block);
+  }
+  if (q) {
+    std::copy(qn, qn + n - m + 1, q);
+  }
+  if (r) {
+    std::copy(un + shift, un + shift + m, r);
+    divWord(r, m, factor);
+  }
+}
+
+// q[0..n - m] = u / v and r[0..m) = u % v for n >= m, v[m - 1] != 0; either
+// output may be null.
+inline void divmod(const Limb* u, size_t n, const Limb* v, size_t m, Limb* q,
+                   Limb* r) {
+  ScratchArena& arena = scratch();
+  ScratchArena::Frame frame(arena);
+  if (m == 1) {
+    Limb* quotient = q ? q : arena.alloc(n);
+    std::copy(u, u + n, quotient);
+    Limb rest = divWord(quotient, n, v[0]);
+    if (r) {
+      r[0] = rest;
+    }
+    return;
+  }
+  if (m >= BigIntegerTuning::bz_threshold &&
+      n - m >= BigIntegerTuning::bz_threshold) {
+    divBurnikelZiegler(u, n, v, m, q, r);
+    return;
+  }
+  Limb factor = normalizer(v[m - 1]);
+  Limb* un = arena.alloc(n + 1);
+  Limb* vn = arena.alloc(m);
+  un[n] = mulWord(u, n, factor, un);
+  mulWord(v, m, factor, vn);
+  divKnuth(un, n, vn, m, q);
+  if (r) {
+    std::copy(un, un + m, r);
+    divWord(r, m, factor);
+  }
+}
+
+// ==============GCD==============
+
+#ifdef BIGINT_BINARY_LIMBS
+// Lehmer cofactors stay below this bound, so they fit an int64_t and mulAdd.
+const int64_t kCofactorLimit = int64_t(1) << 62;
+
+// x = the top 62 bits of a[0..n), n >= 2, and y = the bits of b[0..m) at the
+// same positions; m >= n - 1.
+inline void leadingBits(const Limb* a, size_t n, const Limb* b, size_t m,
+                        int64_t& x, int64_t& y) {
+  int shift = __builtin_clzll(a[n - 1]);
+  DoubleLimb top = wide(a[n - 1], a[n - 2]) << shift;
+  x = static_cast<int64_t>(top >> 66);
+  top = wide(m == n ? b[n - 1] : 0, b[n - 2]) << shift;
+  y = static_cast<int64_t>(top >> 66);
+}
+#else
+const int64_t kCofactorLimit = BASE;
+
+// x = the top two limbs of a[0..n), n >= 2, and y = the limbs of b[0..m) at
+// the same positions; m >= n - 1.
+inline void leadingBits(const Limb* a, size_t n, const Limb* b, size_t m,
+                        int64_t& x, int64_t& y) {
+  x = static_cast<int64_t>(a[n - 1] * BASE + a[n - 2]);
+  y = static_cast<int64_t>((m == n ? b[n - 1] : 0) * BASE + b[n - 2]);
+}
+#endif
+
+// Word-sized cofactors of several Euclidean steps: a' = a * a + b * b and
+// b' = c * a + d * b.
+struct Cofactors {
+  int64_t a = 1, b = 0, c = 0, d = 1;
+};
+
+// Runs Euclid on the leading bits of a >= b (Knuth, TAOCP 4.5.2, Algorithm L)
+// for as long as the quotients are certain to match those of the full
+// operands. cofactors.b stays zero when not even the first one is.
+inline Cofactors lehmerCofactors(const Limb* a, size_t n, const Limb* b,
+                                 size_t m) {
+  Cofactors f;
+  int64_t x, y;
+  leadingBits(a, n, b, m, x, y);
+  while (y + f.c > 0 && y + f.d > 0) {
+    int64_t q = (x + f.a) / (y + f.c);
+    if (q == 0 || q != (x + f.b) / (y + f.d)) {
+      break;
+    }
+    __int128 c = f.a - static_cast<__int128>(q) * f.c;
+    __int128 d = f.b - static_cast<__int128>(q) * f.d;
+    if (c <= -kCofactorLimit || c >= kCofactorLimit ||
+        d <= -kCofactorLimit || d >= kCofactorLimit) {
+      break;
+    }
+    f = {f.c, f.d, static_cast<int64_t>(c), static_cast<int64_t>(d)};
+    int64_t rest = x - q * y;
+    x = y;
+    y = rest;
+  }
+  return f;
+}
+
+// out[0..n) = a[0..n) * x - b[0..n) * y, which must be nonnegative and fit;
+// x and y are below kCofactorLimit.
+inline void mulSubMul(const Limb* a, Limb x, const Limb* b, Limb y, size_t n,
+                      Limb* out) {
+  Limb carry_a = 0;
+  Limb carry_b = 0;
+  Limb borrow = 0;
+  for (size_t i = 0; i < n; ++i) {
+    Limb pa = mulAdd(a[i], x, 0, carry_a);
+    Limb pb = mulAdd(b[i], y, 0, carry_b);
+    out[i] = subBorrow(pa, pb, borrow);
+  }
+}
+
+// out[0..n) = a * u + b * v for cofactors of opposite signs.
+inline void applyCofactors(const Limb* u, const Limb* v, size_t n, int64_t a,
+                           int64_t b, Limb* out) {
+  if (b <= 0) {
+    mulSubMul(u, a, v, -b, n, out);
+  } else {
+    mulSubMul(v, b, u, -a, n, out);
+  }
+}
+
+inline Limb binaryGcd(Limb a, Limb b) {
+  if (!a || !b) {
+    return a | b;
+  }
+  int shift = __builtin_ctzll(a | b);
+  a >>= __builtin_ctzll(a);
+  while (b) {
+    b >>= __builtin_ctzll(b);
+    if (a > b) {
+      std::swap(a, b);
+    }
+    b -= a;
+  }
+  return a << shift;
+}
+
+// out = gcd(a[0..n), b[0..m)) by Lehmer's algorithm, finishing with a binary
+// GCD once both operands fit a word; returns its length, zero when both
+// inputs are zero. out needs max(n, m) limbs.
+inline size_t gcd(const Limb* u, size_t n, const Limb* v, size_t m,
+                  Limb* out) {
+  ScratchArena& arena = scratch();
+  ScratchArena::Frame frame(arena);
+  size_t size = std::max(n, m);
+  Limb* a = arena.alloc(size);
+  Limb* b = arena.alloc(size);
+  Limb* rest = arena.alloc(size);
+  Limb* spare = arena.alloc(size);
+  n = trimmed(u, n);
+  m = trimmed(v, m);
+  std::copy(u, u + n, a);
+  std::copy(v, v + m, b);
+  if (compare(a, n, b, m) < 0) {
+    std::swap(a, b);
+    std::swap(n, m);
+  }
+  while (m > 0) {
+    DoubleLimb word = n == 2 ? wide(a[1], a[0]) : a[0];
+    if (n <= 2 && word >> 64 == 0) {
+      Limb low = b[0];
+      if (m == 2) {
+        low = static_cast<Limb>(wide(b[1], b[0]));
+      }
+      Limb high = 0;
+      out[0] = mulAdd(binaryGcd(static_cast<Limb>(word), low), 1, 0, high);
+      if (!high) {
+        return 1;
+      }
+      out[1] = high;
+      return 2;
+    }
+    Cofactors f;
+    if (m + 1 >= n) {
+      f = lehmerCofactors(a, n, b, m);
+    }
+    if (f.b == 0) {
+      divmod(a, n, b, m, nullptr, rest);
+      std::swap(a, b);
+      std::swap(b, rest);
+      n = m;
+      m = trimmed(b, m);
+      continue;
+    }
+    std::fill(b + m, b + n, 0);
+    applyCofactors(a, b, n, f.a, f.b, rest);
+    applyCofactors(a, b, n, f.c, f.d, spare);
+    std::swap(a, rest);
+    std::swap(b, spare);
+    n = trimmed(a, n);
+    m = trimmed(b, n);
+  }
+  std::copy(a, a + n, out);
+  return n;
+}
+
+// ==============Barrett reduction==============
+
+// mu = floor(radix^2n / m[0..n)) into out[0..n + 2); returns its length.
+inline size_t barrettReciprocal(const Limb* m, size_t n, Limb* out) {
+  ScratchArena::Frame frame(scratch());
+  Limb* power = scratch().alloc(2 * n + 1);
+  std::fill(power, power + 2 * n, 0);
+  power[2 * n] = 1;
+  divmod(power, 2 * n + 1, m, n, out, nullptr);
+  return trimmed(out, n + 2);
+}
+
+// out[0..k) = a[0..n) * b[0..m) mod radix^k, skipping the partial products
+// that only reach higher limbs.
+inline void mulLow(const Limb* a, size_t n, const Limb* b, size_t m, size_t k,
+                   Limb* out) {
+  std::fill(out, out + k, 0);
+  for (size_t i = 0; i < m && i < k; ++i) {
+    size_t len = std::min(n, k - i);
+    Limb carry = 0;
+    for (size_t j = 0; j < len; ++j) {
+      out[i + j] = mulAdd(a[j], b[i], out[i + j], carry);
+    }
+    if (i + len < k) {
+      out[i + len] = carry;
+    }
+  }
+}
+
+// out[0..n) = x[0..2n) mod m (Barrett; Menezes et al., Handbook of Applied
+// Cryptography 14.42): the quotient estimate from the top n + 1 limbs of x
+// times mu is at most two short, so two multiplications and at most two
+// subtractions replace the division.
+inline void barrettStep(const Limb* x, const Limb* m, size_t n, const Limb* mu,
+                        size_t mu_len, Limb* out) {
+  ScratchArena& arena = scratch();
+  ScratchArena::Frame frame(arena);
+  Limb* estimate = arena.alloc(n + 1 + mu_len);
+  mul(x + n - 1, n + 1, mu, mu_len, estimate);
+  const Limb* q = estimate + n + 1;
+  size_t q_len = trimmed(q, mu_len);
+  // x - q * m < 3m fits n + 1 limbs, so the low limbs of q * m suffice.
+  Limb* product = arena.alloc(std::max(q_len + n, n + 1));
+  if (q_len < BigIntegerTuning::karatsuba_threshold) {
+    mulLow(m, n, q, q_len, n + 1, product);
+  } else {
+    mul(q, q_len, m, n, product);
+  }
+  Limb* r = arena.alloc(n + 1);
+  std::copy(x, x + n + 1, r);
+  subFrom(r, n + 1, product, std::min(q_len + n, n + 1));
+  while (compare(r, n + 1, m, n) >= 0) {
+    subFrom(r, n + 1, m, n);
+  }
+  std::copy(r, r + n, out);
+}
+
+// out[0..n) = x[0..len) mod m, folding n limbs of x at a time into the
+// remainder once x is past 2n limbs.
+inline void barrettReduce(const Limb* x, size_t len, const Limb* m, size_t n,
+                          const Limb* mu, size_t mu_len, Limb* out) {
+  ScratchArena::Frame frame(scratch());
+  Limb* window = scratch().alloc(2 * n);
+  if (len <= 2 * n) {
+    std::copy(x, x + len, window);
+    std::fill(window + len, window + 2 * n, 0);
+    barrettStep(window, m, n, mu, mu_len, out);
+    return;
+  }
+  std::fill(window + n, window + 2 * n, 0);
+  for (size_t chunk = (len - 1) / n + 1; chunk > 0; --chunk) {
+    size_t low = (chunk - 1) * n;
+    size_t high = std::min(low + n, len);
+    std::copy(x + low, x + high, window);
+    std::fill(window + (high - low), window + n, 0);
+    barrettStep(window, m, n, mu, mu_len, window + n);
+  }
+  std::copy(window + n, window + 2 * n, out);
+}
+
+// Plain residues modulo m[0..n), reduced by Barrett's method.
+struct BarrettRing {
+  const Limb* modulus;
+  size_t n;
+  const Limb* reciprocal;
+  size_t reciprocal_len;
+
+  void multiply(const Limb* a, const Limb* b, Limb* out) const {
+    ScratchArena::Frame frame(scratch());
+    Limb* t = scratch().alloc(2 * n);
+    mul(a, n, b, n, t);
+    barrettStep(t, modulus, n, reciprocal, reciprocal_len, out);
+  }
+};
+
+// ==============Modular exponentiation==============
+
+#ifdef BIGINT_BINARY_LIMBS
+// Montgomery reduction needs a modulus coprime to the radix.
+inline bool coprimeToRadix(Limb low) { return low & 1; }
+
+// -m^-1 modulo the radix for an odd m, by Newton's iteration.
+inline Limb montgomeryInverse(Limb m) {
+  Limb inverse = m;  // m * m == 1 modulo 8 for every odd m
+  for (int i = 0; i < 5; ++i) {
+    inverse *= 2 - m * inverse;
+  }
+  return -inverse;
+}
+#else
+// Montgomery reduction needs a modulus coprime to the radix.
+inline bool coprimeToRadix(Limb low) { return low % 2 && low % 5; }
+
+// -m^-1 modulo BASE for an m coprime to 10, lifting the inverse modulo 10
+// through 10^2, 10^4, 10^8 and 10^16.
+inline Limb montgomeryInverse(Limb m) {
+  static const Limb kInverseMod10[10] = {0, 1, 0, 7, 0, 0, 0, 3, 0, 9};
+  Limb inverse = kInverseMod10[m % 10];
+  for (int i = 0; i < 4; ++i) {
+    inverse = inverse * (BASE + 2 - m * inverse % BASE) % BASE;
+  }
+  return (BASE - inverse) % BASE;
+}
+#endif
+
+// out[0..n) = t * radix^-n mod m (Montgomery's REDC) for t[0..2n] below
+// m * radix^n; t is used as work space. `inverse` is montgomeryInverse(m[0]).
+inline void redc(Limb* t, const Limb* m, size_t n, Limb inverse, Limb* out) {
+  for (size_t i = 0; i < n; ++i) {
+    Limb high = 0;
+    Limb factor = mulAdd(t[i], inverse, 0, high);
+    addMulWord(t + i, 2 * n + 1 - i, m, n, factor);
+  }
+  Limb* r = t + n;
+  if (r[n] || compare(r, n, m, n) >= 0) {
+    subLimbs(r, n + 1, m, n, r);
+  }
+  std::copy(r, r + n, out);
+}
+
+// Residues modulo m[0..n) in Montgomery form: a stands for a * radix^-n.
+struct MontgomeryRing {
+  const Limb* modulus;
+  size_t n;
+  Limb inverse;
+
+  // out = a * b * radix^-n mod m; out may alias a or b.
+  void multiply(const Limb* a, const Limb* b, Limb* out) const {
+    ScratchArena::Frame frame(scratch());
+    Limb* t = scratch().alloc(2 * n + 1);
+    mul(a, n, b, n, t);
+    t[2 * n] = 0;
+    redc(t, modulus, n, inverse, out);
+  }
+};
+
+// The binary digits of e[0..n), least significant first.
+inline std::vector<bool> binaryDigits(const Limb* e, size_t n) {
+  const Limb kChunk = Limb(1) << 28;
+  ScratchArena::Frame frame(scratch());
+  Limb* rest = scratch().alloc(n);
+  std::copy(e, e + n, rest);
+  std::vector<bool> bits;
+  for (n = trimmed(rest, n); n > 0; n = trimmed(rest, n)) {
+    Limb chunk = divWord(rest, n, kChunk);
+    for (int i = 0; i < 28; ++i) {
+      bits.push_back(chunk >> i & 1);
+    }
+  }
+  while (!bits.empty() && !bits.back()) {
+    bits.pop_back();
+  }
+  return bits;
+}
+
+// out = x^e for residues of ring.n limbs, scanning e[0..en) left to right
+// in windows of up to k bits that start and end with a one, so only the odd
+// powers of x below 2^k are precomputed. `one` is the ring's unit.
+template <class Ring>
+void powWindow(const Ring& ring, const Limb* x, const Limb* one,
+               const Limb* e, size_t en, Limb* out) {
+  size_t n = ring.n;
+  std::vector<bool> bits = binaryDigits(e, en);
+  size_t k = bits.size() > 670   ? 6
+             : bits.size() > 240 ? 5
+             : bits.size() > 80  ? 4
+             : bits.size() > 24  ? 3
+             : bits.size() > 6   ? 2
+                                 : 1;
+  ScratchArena::Frame frame(scratch());
+  size_t count = size_t(1) << (k - 1);
+  Limb* powers = scratch().alloc(count * n);
+  Limb* square = scratch().alloc(n);
+  std::copy(x, x + n, powers);
+  if (count > 1) {
+    ring.multiply(x, x, square);
+  }
+  for (size_t i = 1; i < count; ++i) {
+    ring.multiply(powers + (i - 1) * n, square, powers + i * n);
+  }
+  std::copy(one, one + n, out);
+  bool started = false;
+  for (size_t i = bits.size(); i > 0;) {
+    if (!bits[i - 1]) {
+      ring.multiply(out, out, out);
+      --i;
+      continue;
+    }
+    size_t low = i > k ? i - k : 0;
+    while (!bits[low]) {
+      ++low;
+    }
+    size_t window = 0;
+    for (size_t j = i; j > low; --j) {
+      window = window << 1 | bits[j - 1];
+      if (started) {
+        ring.multiply(out, out, out);
+      }
+    }
+    if (started) {
+      ring.multiply(out, powers + (window >> 1) * n, out);
+    } else {
+      std::copy(powers + (window >> 1) * n, powers + (window >> 1) * n + n,
+                out);
+      started = true;
+    }
+    i = low;
+  }
+}
+
+// ==============Radix conversion==============
+
+inline size_t decimalWidth(Limb v) {
+  size_t width = 1;
+  for (; v >= 10; v /= 10) {
+    ++width;
+  }
+  return width;
+}
+
+// Writes the `width` low decimal digits of v, most significant first.
+inline void writeDigits(Limb v, char* out, size_t width) {
+  for (size_t i = width; i > 0; --i) {
+    out[i - 1] = static_cast<char>('0' + v % 10);
+    v /= 10;
+  }
+}
+
+// Writes the DECIMAL_GROUP_POWER-ary digits groups[0..count) left-padded with
+// zeros to at least `width` characters. Returns the end of the output, or
+// nullptr if it does not fit before `last`.
+inline char* writeGroups(const Limb* groups, size_t count, size_t width,
+                         char* out, char* last) {
+  size_t digits =
+      count ? (count - 1) * DECIMAL_GROUP + decimalWidth(groups[count - 1]) : 0;
+  size_t length = std::max(digits, width);
+  if (static_cast<size_t>(last - out) < length) {
+    return nullptr;
+  }
+  std::fill(out, out + length - digits, '0');
+  out += length - digits;
+  if (count == 0) {
+    return out;
+  }
+  size_t top = digits - (count - 1) * DECIMAL_GROUP;
+  writeDigits(groups[count - 1], out, top);
+  out += top;
+  for (size_t i = count - 1; i > 0; --i) {
+    writeDigits(groups[i - 1], out, DECIMAL_GROUP);
+    out += DECIMAL_GROUP;
+  }
+  return out;
+}
+
+#ifdef BIGINT_BINARY_LIMBS
+// 10^(DECIMAL_GROUP * 2^k), squared up on demand and kept per thread.
+inline const std::vector<Limb>& decimalPower(size_t k) {
+  thread_local std::deque<std::vector<Limb>> powers;
+  while (powers.size() <= k) {
+    if (powers.empty()) {
+      powers.push_back({DECIMAL_GROUP_POWER});
+      continue;
+    }
+    const std::vector<Limb>& root = powers.back();
+    std::vector<Limb> power(2 * root.size());
+    mul(root.data(), root.size(), root.data(), root.size(), power.data());
+    power.resize(trimmed(power.data(), power.size()));
+    powers.push_back(std::move(power));
+  }
+  return powers[k];
+}
+
+// Writes x[0..n) by repeated division by the group power, zero-padded to
+// `width` characters.
+inline char* writeSmall(const Limb* x, size_t n, size_t width, char* out,
+                        char* last) {
+  ScratchArena& arena = scratch();
+  ScratchArena::Frame frame(arena);
+  Limb* rest = arena.alloc(n);
+  Limb* groups = arena.alloc(n + n / 16 + 2);
+  std::copy(x, x + n, rest);
+  const WordInverse group(DECIMAL_GROUP_POWER);
+  size_t count = 0;
+  for (n = trimmed(rest, n); n > 0; n = trimmed(rest, n)) {
+    groups[count++] = divWord(rest, n, group);
+  }
+  return writeGroups(groups, count, width, out, last);
+}
+
+// Splits x[0..n) < 10^(DECIMAL_GROUP * 2^k) around the next power down the
+// tree and writes both halves, the low one zero-padded. With `pad` set the
+// output is exactly DECIMAL_GROUP * 2^k characters long.
+inline char* writeDecimal(const Limb* x, size_t n, size_t k, bool pad,
+                          char* out, char* last) {
+  n = trimmed(x, n);
+  if (k == 0 || n <= BigIntegerTuning::radix_threshold) {
+    return writeSmall(x, n, pad ? DECIMAL_GROUP << k : 0, out, last);
+  }
+  const std::vector<Limb>& power = decimalPower(k - 1);
+  size_t m = power.size();
+  if (compare(x, n, power.data(), m) < 0) {  // the high half is zero
+    if (pad) {
+      size_t half = DECIMAL_GROUP << (k - 1);
+      if (static_cast<size_t>(last - out) < half) {
+        return nullptr;
+      }
+      out = std::fill_n(out, half, '0');
+    }
+    return writeDecimal(x, n, k - 1, pad, out, last);
+  }
+  ScratchArena& arena = scratch();
+  ScratchArena::Frame frame(arena);
+  Limb* q = arena.alloc(n - m + 1);
+  Limb* r = arena.alloc(m);
+  divmod(x, n, power.data(), m, q, r);
+  out = writeDecimal(q, n - m + 1, k - 1, pad, out, last);
+  return out ? writeDecimal(r, m, k - 1, true, out, last) : nullptr;
+}
+
+// Writes the decimal digits of x[0..n); nullptr if they do not fit.
+inline char* toDecimal(const Limb* x, size_t n, char* out, char* last) {
+  n = trimmed(x, n);
+  if (n == 0) {
+    return writeGroups(x, 0, 1, out, last);
+  }
+  size_t k = 1;
+  while (2 * decimalPower(k - 1).size() - 2 < n) {
+    ++k;
+  }
+  return writeDecimal(x, n, k, false, out, last);
+}
+#else
+inline char* toDecimal(const Limb* x, size_t n, char* out, char* last) {
+  n = trimmed(x, n);
+  return writeGroups(x, n, 1, out, last);
+}
+#endif
+
+// Eight ASCII characters loaded as one little-endian word.
+inline u_int64_t loadEight(const char* p) {
+  u_int64_t chunk;
+  std::memcpy(&chunk, p, sizeof(chunk));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  chunk = __builtin_bswap64(chunk);
+#endif
+  return chunk;
+}
+
+// True if every byte of the chunk is in '0'..'9'.
+inline bool isEightDigits(u_int64_t chunk) {
+  return ((chunk & 0xF0F0F0F0F0F0F0F0) |
+          (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+         0x3333333333333333;
+}
+
+// Value of eight decimal digits in three multiplications (SWAR).
+inline Limb parseEight(u_int64_t chunk) {
+  chunk -= 0x3030303030303030;
+  chunk = chunk * 10 + (chunk >> 8);
+  return (((chunk & 0x000000FF000000FF) * (100 + (1000000ULL << 32))) +
+          (((chunk >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >>
+         32;
+}
+
+// Value of the digits [p, p + len), len <= 19; clears `valid` on anything
+// that is not a digit.
+inline Limb parseDigits(const char* p, size_t len, bool& valid) {
+  Limb value = 0;
+  for (; len >= 8; p += 8, len -= 8) {
+    u_int64_t chunk = loadEight(p);
+    valid &= isEightDigits(chunk);
+    value = value * 100000000 + parseEight(chunk);
+  }
+  for (; len > 0; ++p, --len) {
+    valid &= static_cast<unsigned char>(*p - '0') < 10;
+    value = value * 10 + static_cast<Limb>(*p - '0');
+  }
+  return value;
+}
+
+inline size_t decimalGroups(size_t digits) {
+  return (digits + DECIMAL_GROUP - 1) / DECIMAL_GROUP;
+}
+
+// groups[0..decimalGroups(n)) = the DECIMAL_GROUP_POWER-ary digits of
+// [first, first + n), least significant first. Validates while converting.
+inline bool parseGroups(const char* first, size_t n, Limb* groups) {
+  bool valid = true;
+  size_t count = decimalGroups(n);
+  const char* p = first + n;
+  for (size_t i = 0; i + 1 < count; ++i) {
+    p -= DECIMAL_GROUP;
+    groups[i] = parseDigits(p, DECIMAL_GROUP, valid);
+  }
+  groups[count - 1] = parseDigits(first, p - first, valid);
+  return valid;
+}
+
+#ifdef BIGINT_BINARY_LIMBS
+// out[0..count) = the value of the groups[0..count) of 19 decimal digits:
+// Horner's scheme for short inputs, otherwise high * 10^(19 * 2^k) + low
+// with the high and low halves assembled recursively.
+inline void fromDecimal(const Limb* groups, size_t count, Limb* out) {
+  std::fill(out, out + count, 0);
+  if (count <= std::max<size_t>(BigIntegerTuning::radix_threshold, 1)) {
+    size_t size = 0;
+    for (size_t i = count; i > 0; --i) {
+      Limb carry = groups[i - 1];
+      for (size_t j = 0; j < size; ++j) {
+        out[j] = mulAdd(out[j], DECIMAL_GROUP_POWER, 0, carry);
+      }
+      if (carry) {
+        out[size++] = carry;
+      }
+    }
+    return;
+  }
+  size_t k = 0;
+  while (size_t(2) << k < count) {
+    ++k;
+  }
+  size_t half = size_t(1) << k;
+  const std::vector<Limb>& power = decimalPower(k);
+  ScratchArena& arena = scratch();
+  ScratchArena::Frame frame(arena);
+  Limb* high = arena.alloc(count - half);
+  Limb* low = arena.alloc(half);
+  fromDecimal(groups + half, count - half, high);
+  fromDecimal(groups, half, low);
+  mul(high, count - half, power.data(), power.size(), out);
+  addTo(out, count, low, half);
+}
+
+// out[0..decimalGroups(n)) = the value of the digits [first, first + n).
+inline bool fromChars(const char* first, size_t n, Limb* out) {
+  ScratchArena& arena = scratch();
+  ScratchArena::Frame frame(arena);
+  Limb* groups = arena.alloc(decimalGroups(n));
+  if (!parseGroups(first, n, groups)) {
+    return false;
+  }
+  fromDecimal(groups, decimalGroups(n), out);
+  return true;
+}
+#else
+inline bool fromChars(const char* first, size_t n, Limb* out) {
+  return parseGroups(first, n, out);
+}
+#endif
+
+}  // namespace bigint_detail
+
+// ==============BigIntegerArena==============
+// Scoped arena for a computation: while it is alive, the temporaries of
+// division, gcd, radix conversion and fast multiplication on this thread come
+// from it, and all of its memory is returned at once when it goes out of
+// scope. Scopes nest; results are ordinary BigIntegers and outlive it.
+class BigIntegerArena {
+ public:
+  explicit BigIntegerArena(size_t limbs = 0)
+      : previous_(bigint_detail::currentScratch()) {
+    if (limbs) {
+      arena_.reserve(limbs);
+    }
+    bigint_detail::currentScratch() = &arena_;
+  }
+  BigIntegerArena(const BigIntegerArena&) = delete;
+  BigIntegerArena& operator=(const BigIntegerArena&) = delete;
+  ~BigIntegerArena() { bigint_detail::currentScratch() = previous_; }
+
+ private:
+  bigint_detail::ScratchArena arena_;
+  bigint_detail::ScratchArena* previous_;
+};
+
+namespace bigint_expr {
+struct Access;
+template <class E>
+class Expression;
+}  // namespace bigint_expr
+
+// ==============WordDivisor==============
+// A machine-word divisor with its reciprocal precomputed. Keep one around to
+// divide many BigIntegers by the same value without recomputing it.
+class WordDivisor {
+ public:
+  WordDivisor(int64_t divisor)
+      : value_(divisor),
+        magnitude_(divisor < 0 ? -static_cast<u_int64_t>(divisor)
+                               : static_cast<u_int64_t>(divisor)),
+        inverse_(magnitude_ ? magnitude_ : 1) {}
+
+  int64_t value() const { return value_; }
+
+  u_int64_t magnitude() const { return magnitude_; }
+
+  const bigint_detail::WordInverse& inverse() const { return inverse_; }
+
+ private:
+  int64_t value_;
+  u_int64_t magnitude_;
+  bigint_detail::WordInverse inverse_;
+};
+
+class BigInteger {
+ private:
+  bigint_detail::LimbVector digits_;  // the sign lives in its flag bit
+
+ public:
+  inline BigInteger() : BigInteger(0){};
+  inline BigInteger(int64_t number);  // bigint from number
+
+  inline BigInteger(int64_t number, size_t len);
+
+  inline BigInteger(std::string_view str);  // bigint from string
+
+  inline BigInteger(const BigInteger& other, bool negative);
+
+  // Evaluates a lazy expression (see bigint_expr) directly into the result.
+  template <class E>
+  BigInteger(const bigint_expr::Expression<E>& expression);
+
+  template <class E>
+  BigInteger& operator=(const bigint_expr::Expression<E>& expression);
+
+  explicit operator bool() const;
+
+  explicit operator double() const;
+
+  size_t len() const;
+
+  std::string toStringOld() const;
+
+  inline std::string toString() const;
+
+  // Upper bound on the characters to_chars writes, sign included.
+  size_t maxDecimalLength() const;
+
+  // Writes the decimal form into [first, last) without touching the heap once
+  // the per-thread scratch space and power tables have warmed up.
+  friend std::to_chars_result to_chars(char* first, char* last,
+                                       const BigInteger& value);
+
+  // Parses an optional '-' and decimal digits from [first, last) the way
+  // std::from_chars does, validating the digits while converting them.
+  friend std::from_chars_result from_chars(const char* first, const char* last,
+                                           BigInteger& value);
+
+  uint64_t operator[](size_t index) const { return digits_[index]; }
+
+  uint64_t& operator[](size_t index) { return digits_[index]; }
+
+  bool isNegative() const { return digits_.flag(); }
+
+  BigInteger operator-() const { return BigInteger(*this, !isNegative()); }
+  void invert() { setSign(!isNegative()); };
+
+  void makeAbs() { setSign(false); }
+
+  BigInteger abs() const { return BigInteger(*this, false); }
+
+  void setSign(bool sign) { digits_.setFlag(sign); }
+
+  friend BigInteger operator+(BigInteger lhs, const BigInteger& rhs);
+
+  friend BigInteger operator-(BigInteger lhs, const BigInteger& rhs);
+
+  BigInteger& operator+=(const BigInteger& other);
+
+  BigInteger& operator-=(const BigInteger& other);
+
+  friend BigInteger operator*(const BigInteger& a, const int64_t n);
+
+  friend BigInteger operator*(const BigInteger& lhs, const BigInteger& rhs);
+
+  // x * x through the squaring kernels; x * x and x *= x take them as well.
+  friend BigInteger square(const BigInteger& x);
+
+  BigInteger& operator*=(const BigInteger& rhs);
+
+  BigInteger& operator*=(const int64_t number);
+
+  friend BigInteger operator/(const BigInteger& a, const BigInteger& b);
+
+  BigInteger& operator/=(const BigInteger& b);
+
+  friend BigInteger operator/(BigInteger a, const int64_t& n);
+
+  BigInteger& operator/=(const int64_t& n);
+
+  // a becomes the truncated quotient a / d; returns the remainder, which has
+  // the sign of the dividend. Dividing by zero yields zeros.
+  friend int64_t divmod_word(BigInteger& a, const WordDivisor& d);
+
+  friend int64_t operator%(const BigInteger& a, const WordDivisor& d);
+
+  friend int64_t operator%(const BigInteger& a, int64_t n);
+
+  BigInteger& operator%=(const BigInteger& a);
+
+  friend BigInteger operator%(const BigInteger& a, const BigInteger& b);
+
+  // Truncating division: the quotient rounds toward zero and the remainder
+  // takes the sign of the dividend. Dividing by zero yields zeros.
+  friend std::pair<BigInteger, BigInteger> divmod(const BigInteger& a,
+                                                  const BigInteger& b);
+
+  friend void quotRem(const BigInteger& a, const BigInteger& b,
+                      BigInteger& quotient, BigInteger& remainder);
+
+  // *this becomes the quotient; the remainder goes to `remainder`.
+  BigInteger& quotRem(const BigInteger& b, BigInteger& remainder);
+
+  // acc += x * y and acc -= x * y, multiplying straight into acc's limbs.
+  friend void addmul(BigInteger& acc, const BigInteger& x, const BigInteger& y);
+
+  friend void submul(BigInteger& acc, const BigInteger& x, const BigInteger& y);
+
+  friend void addmul_word(BigInteger& acc, const BigInteger& x, int64_t w);
+
+  // Nonnegative greatest common divisor; gcd(0, 0) == 0.
+  friend BigInteger gcd(const BigInteger& a, const BigInteger& b);
+
+  // x^k by binary powering on the squaring kernel; 0^0 == 1.
+  friend BigInteger pow(const BigInteger& x, uint64_t k);
+
+  // floor(x^(1/k)). Odd roots of negative x truncate toward zero; even
+  // roots of negative x and k == 0 yield zero.
+  friend BigInteger iroot(const BigInteger& x, uint64_t k);
+
+  BigInteger& operator++();
+
+  BigInteger operator++(int);
+
+  BigInteger& operator--();
+
+  BigInteger operator--(int);
+
+  friend std::istream& operator>>(std::istream& in, BigInteger& bi);
+
+  friend std::ostream& operator<<(std::ostream& out, const BigInteger& bi);
+
+  void trimLeft() {
+    size_t size = digits_.size();
+    while (size > 1 && digits_[size - 1] == 0) {
+      --size;
+    }
+    digits_.resize(size);
+  }
+
+  void shiftLeft();
+
+ private:
+  friend struct bigint_expr::Access;
+  friend class MontgomeryContext;
+  friend class BigModulus;
+
+  // *this += (negative ? -b : b) for the magnitude b[0..m), in place; the
+  // limbs grow only when the result needs them. b may be *this's own limbs.
+  void addSigned(const bigint_detail::Limb* b, size_t m, bool negative);
+
+  // *this += (negative ? -a * b : a * b) for magnitudes a[0..n) and b[0..m)
+  // that do not point into *this.
+  void addProduct(const bigint_detail::Limb* a, size_t n,
+                  const bigint_detail::Limb* b, size_t m, bool negative);
+
+  // Replaces the value with the magnitude limbs[0..n), reusing the buffer.
+  void assign(const bigint_detail::Limb* limbs, size_t n, bool negative);
+
+  // *this *= radix^count.
+  void shiftLimbs(size_t count);
+
+  // Either output may be null; outputs may alias the operands.
+  static void divide(const BigInteger& a, const BigInteger& b,
+                     BigInteger* quotient, BigInteger* remainder);
+
+  // Cofactors of a run of Euclidean steps: (a', b') = M (a, b).
+  struct GcdMatrix;
+
+  // One Lehmer step on a >= b > 0, or a division when not even one quotient
+  // is certain; the step is multiplied into `matrix` unless it is null.
+  static void gcdStep(BigInteger& a, BigInteger& b, GcdMatrix* matrix);
+
+  // Runs Euclid on a >= b >= 0 until b has at most half of a's limbs plus
+  // one. Past half_gcd_threshold limbs the leading halves are reduced first
+  // and their cofactors applied with fast multiplication.
+  static void halfGcd(BigInteger& a, BigInteger& b, GcdMatrix* matrix);
+};
+
+std::string numToString(u_int64_t number, bool fixW) {
+  std::string tmp = std::to_string(number);
+  if ((tmp.length() < BASE_LENGTH) && fixW) {
+    tmp = std::string(BASE_LENGTH - tmp.length(), '0') + tmp;
+  }
+  return tmp;
+}
+
+BigInteger::BigInteger(int64_t number) {  // bigint from number
+  digits_.clear();
+  u_int64_t magnitude =
+      number < 0 ? -static_cast<u_int64_t>(number) : static_cast<u_int64_t>(number);
+#ifdef BIGINT_BINARY_LIMBS
+  if (magnitude) {
+    digits_.push_back(magnitude);
+  }
+#else
+  while (magnitude) {
+    digits_.push_back(magnitude % BASE);
+    magnitude /= BASE;
+  }
+#endif
+  if (digits_.size() == 0) {
+    digits_.push_back(0);
+  }
+  setSign(number < 0);
+}
+
+BigInteger::BigInteger(int64_t number, size_t len) {
+  digits_.resize(len, number);
+  setSign(false);
+}
+
+BigInteger::BigInteger(std::string_view str) : BigInteger(0) {
+  from_chars(str.data(), str.data() + str.size(), *this);
+}
+
+std::from_chars_result from_chars(const char* first, const char* last,
+                                  BigInteger& value) {
+  const char* digits = first + (first != last && *first == '-');
+  size_t n = last - digits;
+  if (n == 0) {
+    return {first, std::errc::invalid_argument};
+  }
+  BigInteger result(0, bigint_detail::decimalGroups(n));
+  if (!bigint_detail::fromChars(digits, n, result.digits_.data())) {
+    // Like std::from_chars, stop at the first character that is not a digit.
+    const char* end = std::find_if(digits, last, [](char c) {
+      return static_cast<unsigned char>(c - '0') >= 10;
+    });
+    if (end == digits) {
+      return {first, std::errc::invalid_argument};
+    }
+    return from_chars(first, end, value);
+  }
+  result.trimLeft();
+  result.setSign(digits != first && result);
+  value = std::move(result);
+  return {last, std::errc()};
+}
+
+BigInteger::BigInteger(const BigInteger& other,
+                       bool negative)
+    : digits_(other.digits_) {  // copy constructor
+  setSign(negative);
+}
+
+void parseString(std::string str, std::vector<u_int64_t>& dest) {
+  std::reverse(str.begin(), str.end());
+  u_int64_t buffer = 0;
+  size_t pos = 0;
+  size_t power = 1;
+  for (size_t i = 0; i < str.length(); ++i) {
+    if ((i % BASE_LENGTH == 0) && i > 0) {
+      dest[pos++] = buffer;
+      buffer = 0;
+      power = 1;
+    }
+    if (str[i] != '-') {
+      buffer += (str[i] - '0') * power;
+      power *= 10;
+    }
+  }
+  if (buffer) {
+    dest[pos] = buffer;
+    buffer = 0;
+  }
+}
+
+size_t BigInteger::maxDecimalLength() const {
+  return len() * (bigint_detail::DECIMAL_GROUP + 1) + 1;
+}
+
+std::to_chars_result to_chars(char* first, char* last,
+                              const BigInteger& value) {
+  char* out = first;
+  if (value.isNegative() && value) {
+    if (out == last) {
+      return {last, std::errc::value_too_large};
+    }
+    *out++ = '-';
+  }
+  out = bigint_detail::toDecimal(value.digits_.data(), value.len(), out, last);
+  if (!out) {
+    return {last, std::errc::value_too_large};
+  }
+  return {out, std::errc()};
+}
+
+std::string BigInteger::toString() const {
+  std::string s(maxDecimalLength(), '0');
+  char* first = s.data();
+  s.resize(to_chars(first, first + s.size(), *this).ptr - first);
+  return s;
+}
+
+bool operator<(const BigInteger& lhs, const BigInteger& rhs) {
+  if (lhs.isNegative() && !rhs.isNegative()) {
+    return true;
+  }
+  if (!lhs.isNegative() && rhs.isNegative()) {
+    return false;
+  }
+  if (lhs.len() < rhs.len()) {
+    return !lhs.isNegative();
+  }
+  if (lhs.len() > rhs.len()) {
+    return lhs.isNegative();
+  }
+  for (size_t i = lhs.len(); i > 0; --i) {
+    if (lhs[i - 1] < rhs[i - 1]) {
+      return !lhs.isNegative();
+    }
+    if (lhs[i - 1] > rhs[i - 1]) {
+      return lhs.isNegative();
+    }
+  }
+  return (!lhs.isNegative() ? false : true);
+}
+
+bool operator>(const BigInteger& lhs, const BigInteger& rhs) {
+  return rhs < lhs;
+}
+
+bool operator<=(const BigInteger& lhs, const BigInteger& rhs) {
+  return !(lhs > rhs);
+}
+
+bool operator>=(const BigInteger& lhs, const BigInteger& rhs) {
+  return !(lhs < rhs);
+}
+
+bool operator==(const BigInteger& lhs, const BigInteger& rhs) {
+  if (lhs.len() != rhs.len()) {
+    return false;
+  }
+  for (size_t i = lhs.len(); i > 0; --i) {
+    if (lhs[i - 1] != rhs[i - 1]) {
+      return false;
+    }
+  }
+  return lhs.isNegative() == rhs.isNegative();
+}
+
+bool operator!=(const BigInteger& lhs, const BigInteger& rhs) {
+  return !(lhs == rhs);
+}
+
+void BigInteger::addSigned(const bigint_detail::Limb* b, size_t m,
+                           bool negative) {
+  size_t n = len();
+  m = bigint_detail::trimmed(b, m);
+  if (negative == isNegative()) {
+    if (n < m) {
+      digits_.resize(m);
+    }
+    bigint_detail::Limb carry =
+        bigint_detail::addTo(digits_.data(), digits_.size(), b, m);
+    if (carry) {
+      digits_.push_back(carry);
+    }
+  } else if (bigint_detail::compare(digits_.data(), n, b, m) >= 0) {
+    bigint_detail::subFrom(digits_.data(), n, b, m);
+  } else {
+    digits_.resize(m);
+    bigint_detail::subLimbs(b, m, digits_.data(), n, digits_.data());
+    setSign(negative);
+  }
+  trimLeft();
+  setSign(isNegative() && *this);
+}
+
+void BigInteger::assign(const bigint_detail::Limb* limbs, size_t n,
+                        bool negative) {
+  digits_.assign(limbs, limbs + n);
+  if (n == 0) {
+    digits_.push_back(0);
+  }
+  trimLeft();
+  setSign(negative && *this);
+}
+
+void BigInteger::addProduct(const bigint_detail::Limb* a, size_t n,
+                            const bigint_detail::Limb* b, size_t m,
+                            bool negative) {
+  if (n < m) {
+    std::swap(a, b);
+    std::swap(n, m);
+  }
+#ifdef BIGINT_BINARY_LIMBS
+  bool rows = m < BigIntegerTuning::karatsuba_threshold;
+#else
+  // The decimal schoolbook kernel defers its carries, which beats carrying
+  // every row into the accumulator.
+  bool rows = m == 1;
+#endif
+  if (!rows) {
+    bigint_detail::ScratchArena& arena = bigint_detail::scratch();
+    bigint_detail::ScratchArena::Frame frame(arena);
+    bigint_detail::Limb* product = arena.alloc(n + m);
+    bigint_detail::mul(a, n, b, m, product);
+    addSigned(product, bigint_detail::trimmed(product, n + m), negative);
+    return;
+  }
+  // Schoolbook rows accumulated directly into the limbs of *this.
+  size_t k = std::max(len(), n + m) + 1;
+  digits_.resize(k);
+  bigint_detail::Limb* acc = digits_.data();
+  if (negative == isNegative()) {
+    for (size_t j = 0; j < m; ++j) {
+      bigint_detail::addMulWord(acc + j, k - j, a, n, b[j]);
+    }
+  } else {
+    bigint_detail::Limb wrapped = 0;
+    for (size_t j = 0; j < m; ++j) {
+      wrapped |= bigint_detail::subMulWord(acc + j, k - j, a, n, b[j]);
+    }
+    if (wrapped) {
+      bigint_detail::negateLimbs(acc, k);
+      setSign(negative);
+    }
+  }
+  trimLeft();
+  setSign(isNegative() && *this);
+}
+
+BigInteger operator+(BigInteger lhs, const BigInteger& rhs) {
+  lhs += rhs;
+  return lhs;
+}
+
+BigInteger operator-(BigInteger lhs, const BigInteger& rhs) {
+  lhs -= rhs;
+  return lhs;
+}
+
+BigInteger& BigInteger::operator+=(const BigInteger& other) {
+  addSigned(other.digits_.data(), other.len(), other.isNegative());
+  return *this;
+}
+
+BigInteger& BigInteger::operator-=(const BigInteger& other) {
+  addSigned(other.digits_.data(), other.len(), !other.isNegative() && other);
+  return *this;
+}
+
+BigInteger operator*(const BigInteger& a, int64_t n) {
+  if (!a || !n) {
+    return BigInteger(0);
+  }
+  u_int64_t magnitude =
+      n < 0 ? -static_cast<u_int64_t>(n) : static_cast<u_int64_t>(n);
+  if (magnitude > bigint_detail::LIMB_MAX) {
+    return a * BigInteger(n);
+  }
+  BigInteger product(0, a.len() + 1);
+  product.setSign(a.isNegative() ^ (n < 0));
+  product[a.len()] = bigint_detail::mulWord(a.digits_.data(), a.len(),
+                                            magnitude, product.digits_.data());
+  product.trimLeft();
+  return product;
+}
+
+BigInteger& BigInteger::operator*=(const int64_t number) {
+  u_int64_t magnitude = number < 0 ? -static_cast<u_int64_t>(number)
+                                   : static_cast<u_int64_t>(number);
+  if (magnitude > bigint_detail::LIMB_MAX) {
+    return *this *= BigInteger(number);
+  }
+  bigint_detail::Limb carry = bigint_detail::mulWord(
+      digits_.data(), len(), magnitude, digits_.data());
+  if (carry) {
+    digits_.push_back(carry);
+  }
+  trimLeft();
+  setSign((isNegative() ^ (number < 0)) && *this);
+  return *this;
+}
+
+BigInteger operator*(const BigInteger& lhs, const BigInteger& rhs) {
+  if (!lhs || !rhs) {
+    return BigInteger(0);
+  }
+  BigInteger product(0, lhs.len() + rhs.len());
+  bigint_detail::mul(lhs.digits_.data(), lhs.len(), rhs.digits_.data(),
+                     rhs.len(), product.digits_.data());
+  product.trimLeft();
+  product.setSign(lhs.isNegative() ^ rhs.isNegative());
+  return product;
+}
+
+BigInteger square(const BigInteger& x) {
+  return x * x;
+}
+
+BigInteger& BigInteger::operator*=(const BigInteger& rhs) {
+  bigint_detail::ScratchArena& arena = bigint_detail::scratch();
+  bigint_detail::ScratchArena::Frame frame(arena);
+  size_t n = len() + rhs.len();
+  bigint_detail::Limb* product = arena.alloc(n);
+  bigint_detail::mul(digits_.data(), len(), rhs.digits_.data(), rhs.len(),
+                     product);
+  assign(product, n, isNegative() ^ rhs.isNegative());
+  return *this;
+}
+
+int64_t divmod_word(BigInteger& a, const WordDivisor& d) {
+  if (!d.magnitude()) {
+    const bigint_detail::Limb zero = 0;
+    a.assign(&zero, 1, false);
+    return 0;
+  }
+  u_int64_t rest =
+      bigint_detail::divWord(a.digits_.data(), a.len(), d.inverse());
+  bool negative = a.isNegative();
+  a.trimLeft();
+  a.setSign((negative ^ (d.value() < 0)) && a);
+  return negative ? -static_cast<int64_t>(rest) : static_cast<int64_t>(rest);
+}
+
+BigInteger operator/(BigInteger a, const int64_t& n) {
+  divmod_word(a, WordDivisor(n));
+  return a;
+}
+
+BigInteger& BigInteger::operator/=(const int64_t& n) {
+  divmod_word(*this, WordDivisor(n));
+  return *this;
+}
+
+int64_t operator%(const BigInteger& a, const WordDivisor& d) {
+  if (!d.magnitude()) {
+    return 0;
+  }
+  u_int64_t rest =
+      bigint_detail::modWord(a.digits_.data(), a.len(), d.inverse());
+  return a.isNegative() ? -static_cast<int64_t>(rest)
+                     : static_cast<int64_t>(rest);
+}
+
+int64_t operator%(const BigInteger& a, int64_t n) {
+  return a % WordDivisor(n);
+}
+
+void BigInteger::divide(const BigInteger& a, const BigInteger& b,
+                        BigInteger* quotient, BigInteger* remainder) {
+  if (!b || bigint_detail::compare(a.digits_.data(), a.len(),
+                                   b.digits_.data(), b.len()) < 0) {
+    const bigint_detail::Limb zero = 0;
+    if (remainder && !b) {
+      remainder->assign(&zero, 1, false);
+    } else if (remainder && remainder != &a) {
+      *remainder = a;
+    }
+    if (quotient) {
+      quotient->assign(&zero, 1, false);
+    }
+    return;
+  }
+  bigint_detail::ScratchArena& arena = bigint_detail::scratch();
+  bigint_detail::ScratchArena::Frame frame(arena);
+  size_t n = a.len();
+  size_t m = b.len();
+  bigint_detail::Limb* q = quotient ? arena.alloc(n - m + 1) : nullptr;
+  bigint_detail::Limb* r = remainder ? arena.alloc(m) : nullptr;
+  bigint_detail::divmod(a.digits_.data(), n, b.digits_.data(), m, q, r);
+  bool negative = a.isNegative();
+  bool fraction_negative = a.isNegative() ^ b.isNegative();
+  if (quotient) {
+    quotient->assign(q, n - m + 1, fraction_negative);
+  }
+  if (remainder) {
+    remainder->assign(r, m, negative);
+  }
+}
+
+BigInteger operator/(const BigInteger& a, const BigInteger& b) {
+  BigInteger fraction;
+  BigInteger::divide(a, b, &fraction, nullptr);
+  return fraction;
+}
+
+BigInteger& BigInteger::operator/=(const BigInteger& b) {
+  divide(*this, b, this, nullptr);
+  return *this;
+}
+
+BigInteger operator%(const BigInteger& a, const BigInteger& b) {
+  BigInteger rest;
+  BigInteger::divide(a, b, nullptr, &rest);
+  return rest;
+}
+
+BigInteger& BigInteger::operator%=(const BigInteger& a) {
+  divide(*this, a, nullptr, this);
+  return *this;
+}
+
+std::pair<BigInteger, BigInteger> divmod(const BigInteger& a,
+                                         const BigInteger& b) {
+  std::pair<BigInteger, BigInteger> result;
+  BigInteger::divide(a, b, &result.first, &result.second);
+  return result;
+}
+
+void quotRem(const BigInteger& a, const BigInteger& b, BigInteger& quotient,
+             BigInteger& remainder) {
+  BigInteger::divide(a, b, &quotient, &remainder);
+}
+
+BigInteger& BigInteger::quotRem(const BigInteger& b, BigInteger& remainder) {
+  divide(*this, b, this, &remainder);
+  return *this;
+}
+
+void addmul(BigInteger& acc, const BigInteger& x, const BigInteger& y) {
+  if (&acc == &x || &acc == &y) {
+    acc += x * y;
+    return;
+  }
+  acc.addProduct(x.digits_.data(), x.len(), y.digits_.data(), y.len(),
+                 x.isNegative() ^ y.isNegative());
+}
+
+void submul(BigInteger& acc, const BigInteger& x, const BigInteger& y) {
+  if (&acc == &x || &acc == &y) {
+    acc -= x * y;
+    return;
+  }
+  acc.addProduct(x.digits_.data(), x.len(), y.digits_.data(), y.len(),
+                 !(x.isNegative() ^ y.isNegative()));
+}
+
+void addmul_word(BigInteger& acc, const BigInteger& x, int64_t w) {
+  u_int64_t magnitude =
+      w < 0 ? -static_cast<u_int64_t>(w) : static_cast<u_int64_t>(w);
+  if (&acc == &x || magnitude > bigint_detail::LIMB_MAX) {
+    addmul(acc, BigInteger(x), BigInteger(w));
+    return;
+  }
+  acc.addProduct(x.digits_.data(), x.len(), &magnitude, 1,
+                 x.isNegative() ^ (w < 0));
+}
+
+BigInteger gcd(const BigInteger& a, const BigInteger& b) {
+  size_t threshold = std::max<size_t>(BigIntegerTuning::half_gcd_threshold, 2);
+  if (std::min(a.len(), b.len()) >= threshold) {
+    BigInteger x(a, false);
+    BigInteger y(b, false);
+    if (x < y) {
+      std::swap(x, y);
+    }
+    while (y.len() >= threshold) {
+      if (y.len() <= x.len() / 2 + 1) {
+        x %= y;
+        std::swap(x, y);
+      } else {
+        BigInteger::halfGcd(x, y, nullptr);
+      }
+    }
+    return gcd(x, y);
+  }
+  bigint_detail::ScratchArena& arena = bigint_detail::scratch();
+  bigint_detail::ScratchArena::Frame frame(arena);
+  size_t n = a.len();
+  size_t m = b.len();
+  bigint_detail::Limb* divisor = arena.alloc(std::max(n, m));
+  BigInteger result;
+  result.assign(divisor,
+                bigint_detail::gcd(a.digits_.data(), n, b.digits_.data(), m,
+                                   divisor),
+                false);
+  return result;
+}
+
+BigInteger& BigInteger::operator++() {
+  const bigint_detail::Limb one = 1;
+  addSigned(&one, 1, false);
+  return *this;
+}
+
+BigInteger BigInteger::operator++(int) {
+  BigInteger result(*this);
+  ++*this;
+  return result;
+}
+
+BigInteger& BigInteger::operator--() {
+  const bigint_detail::Limb one = 1;
+  addSigned(&one, 1, true);
+  return *this;
+}
+
+BigInteger BigInteger::operator--(int) {
+  BigInteger tmp(*this);
+  --*this;
+  return tmp;
+}
+
+BigInteger::operator bool() const {
+  return (this->len() > 1) || ((this->len() == 1) && (this->digits_[0] != 0));
+}
+
+BigInteger::operator double() const {
+  double num = 0;
+  for (size_t i = len(); i > 0; --i) {
+    num = num * bigint_detail::LIMB_RADIX + digits_[i - 1];
+  }
+  return isNegative() ? -num : num;
+}
+
+size_t BigInteger::len() const { return digits_.size(); }
+
+BigInteger operator""_bi(unsigned long long number) {
+  return BigInteger(number);
+}
+
+BigInteger operator""_bi(const char* number, size_t length) {
+  return BigInteger(std::string_view(number, length));
+}
+
+std::istream& operator>>(std::istream& in, BigInteger& bi) {
+  thread_local std::string buffer;
+  if (in >> buffer) {
+    const char* last = buffer.data() + buffer.size();
+    if (from_chars(buffer.data(), last, bi).ptr != last) {
+      in.setstate(std::ios::failbit);
+    }
+  }
+  return in;
+}
+
+std::ostream& operator<<(std::ostream& out, const BigInteger& bi) {
+  out << bi.toString();
+  return out;
+}
+
+void BigInteger::shiftLeft() {
+  size_t size = digits_.size();
+  if (size > 1 && digits_[size - 1]) {
+    digits_.resize(size + 1);
+    digits_[size] = digits_[size - 1];
+  }
+
+  for (size_t i = digits_.size(); i > 1; --i) digits_[i - 1] = digits_[i - 2];
+}
+
+// ==============Expression templates==============
+// Opt-in lazy arithmetic: wrapping an operand in lazy() makes the +, - and *
+// that follow build an expression tree instead of BigIntegers. Assigning the
+// tree sizes the destination once and accumulates every term into it, so a
+// sum of products such as lazy(a) * b + lazy(c) * d costs one allocation; the
+// products are multiplied straight into it (see addmul). Trees hold their
+// operands by reference, so evaluate them before the operands go away.
+
+namespace bigint_expr {
+
+struct Access {
+  static const bigint_detail::Limb* limbs(const BigInteger& x) {
+    return x.digits_.data();
+  }
+
+  static void add(BigInteger& dest, const bigint_detail::Limb* b, size_t m,
+                  bool negative) {
+    dest.addSigned(b, m, negative);
+  }
+
+  static void addProduct(BigInteger& dest, const BigInteger& a,
+                         const BigInteger& b, bool negative) {
+    dest.addProduct(a.digits_.data(), a.len(), b.digits_.data(), b.len(),
+                    negative);
+  }
+
+  // Zeroes dest with room for `bound` limbs plus the spare carry limb that
+  // addProduct works with.
+  static void reset(BigInteger& dest, size_t bound) {
+    const bigint_detail::Limb zero = 0;
+    dest.digits_.reserve(bound + 1);
+    dest.assign(&zero, 1, false);
+  }
+};
+
+template <class E>
+class Expression {
+ public:
+  const E& self() const { return static_cast<const E&>(*this); }
+};
+
+class Ref : public Expression<Ref> {
+ public:
+  explicit Ref(const BigInteger& value) : value_(value) {}
+
+  const BigInteger& value() const { return value_; }
+
+  size_t bound() const { return value_.len(); }
+
+  bool uses(const BigInteger& x) const { return &value_ == &x; }
+
+  void accumulate(BigInteger& dest, bool negate) const {
+    Access::add(dest, Access::limbs(value_), value_.len(),
+                value_.isNegative() ^ negate);
+  }
+
+ private:
+  const BigInteger& value_;
+};
+
+template <class L, class R, bool Subtract>
+class Sum : public Expression<Sum<L, R, Subtract>> {
+ public:
+  Sum(const L& left, const R& right) : left_(left), right_(right) {}
+
+  size_t bound() const { return std::max(left_.bound(), right_.bound()) + 1; }
+
+  bool uses(const BigInteger& x) const {
+    return left_.uses(x) || right_.uses(x);
+  }
+
+  void accumulate(BigInteger& dest, bool negate) const {
+    left_.accumulate(dest, negate);
+    right_.accumulate(dest, negate ^ Subtract);
+  }
+
+ private:
+  L left_;
+  R right_;
+};
+
+template <class E>
+class Negation : public Expression<Negation<E>> {
+ public:
+  explicit Negation(const E& inner) : inner_(inner) {}
+
+  size_t bound() const { return inner_.bound(); }
+
+  bool uses(const BigInteger& x) const { return inner_.uses(x); }
+
+  void accumulate(BigInteger& dest, bool negate) const {
+    inner_.accumulate(dest, !negate);
+  }
+
+ private:
+  E inner_;
+};
+
+// A product factor: leaves are used in place, anything else is evaluated.
+inline const BigInteger& factor(const Ref& ref, BigInteger&) {
+  return ref.value();
+}
+
+template <class E>
+const BigInteger& factor(const Expression<E>& expression, BigInteger& spare) {
+  spare = expression;
+  return spare;
+}
+
+template <class L, class R>
+class Product : public Expression<Product<L, R>> {
+ public:
+  Product(const L& left, const R& right) : left_(left), right_(right) {}
+
+  size_t bound() const { return left_.bound() + right_.bound(); }
+
+  bool uses(const BigInteger& x) const {
+    return left_.uses(x) || right_.uses(x);
+  }
+
+  void accumulate(BigInteger& dest, bool negate) const {
+    BigInteger left_spare;
+    BigInteger right_spare;
+    const BigInteger& a = factor(left_, left_spare);
+    const BigInteger& b = factor(right_, right_spare);
+    Access::addProduct(dest, a, b, a.isNegative() ^ b.isNegative() ^ negate);
+  }
+
+ private:
+  L left_;
+  R right_;
+};
+
+template <class L, class R>
+Sum<L, R, false> operator+(const Expression<L>& lhs,
+                           const Expression<R>& rhs) {
+  return {lhs.self(), rhs.self()};
+}
+
+template <class L>
+Sum<L, Ref, false> operator+(const Expression<L>& lhs, const BigInteger& rhs) {
+  return {lhs.self(), Ref(rhs)};
+}
+
+template <class R>
+Sum<Ref, R, false> operator+(const BigInteger& lhs, const Expression<R>& rhs) {
+  return {Ref(lhs), rhs.self()};
+}
+
+template <class L, class R>
+Sum<L, R, true> operator-(const Expression<L>& lhs,
+                          const Expression<R>& rhs) {
+  return {lhs.self(), rhs.self()};
+}
+
+template <class L>
+Sum<L, Ref, true> operator-(const Expression<L>& lhs, const BigInteger& rhs) {
+  return {lhs.self(), Ref(rhs)};
+}
+
+template <class R>
+Sum<Ref, R, true> operator-(const BigInteger& lhs, const Expression<R>& rhs) {
+  return {Ref(lhs), rhs.self()};
+}
+
+template <class E>
+Negation<E> operator-(const Expression<E>& expression) {
+  return Negation<E>(expression.self());
+}
+
+template <class L, class R>
+Product<L, R> operator*(const Expression<L>& lhs, const Expression<R>& rhs) {
+  return {lhs.self(), rhs.self()};
+}
+
+template <class L>
+Product<L, Ref> operator*(const Expression<L>& lhs, const BigInteger& rhs) {
+  return {lhs.self(), Ref(rhs)};
+}
+
+template <class R>
+Product<Ref, R> operator*(const BigInteger& lhs, const Expression<R>& rhs) {
+  return {Ref(lhs), rhs.self()};
+}
+
+}  // namespace bigint_expr
+
+inline bigint_expr::Ref lazy(const BigInteger& x) {
+  return bigint_expr::Ref(x);
+}
+
+template <class E>
+BigInteger::BigInteger(const bigint_expr::Expression<E>& expression)
+    : BigInteger() {
+  *this = expression;
+}
+
+template <class E>
+BigInteger& BigInteger::operator=(
+    const bigint_expr::Expression<E>& expression) {
+  if (expression.self().uses(*this)) {
+    BigInteger result(expression);
+    return *this = std::move(result);
+  }
+  bigint_expr::Access::reset(*this, expression.self().bound());
+  expression.self().accumulate(*this, false);
+  return *this;
+}
+
+// ==============Half-GCD==============
+
+struct BigInteger::GcdMatrix {
+  BigInteger m00 = 1, m01 = 0, m10 = 0, m11 = 1;
+
+  // *this = step * *this.
+  void leftMultiply(const GcdMatrix& step) {
+    BigInteger n00 = lazy(step.m00) * m00 + lazy(step.m01) * m10;
+    BigInteger n01 = lazy(step.m00) * m01 + lazy(step.m01) * m11;
+    m10 = lazy(step.m10) * m00 + lazy(step.m11) * m10;
+    m11 = lazy(step.m10) * m01 + lazy(step.m11) * m11;
+    m00 = std::move(n00);
+    m01 = std::move(n01);
+  }
+};
+
+void BigInteger::gcdStep(BigInteger& a, BigInteger& b, GcdMatrix* matrix) {
+  size_t n = a.len();
+  size_t m = b.len();
+  bigint_detail::Cofactors f;
+  if (m + 1 >= n) {
+    f = bigint_detail::lehmerCofactors(a.digits_.data(), n, b.digits_.data(),
+                                       m);
+  }
+  if (f.b == 0) {
+    BigInteger quotient;
+    divide(a, b, &quotient, &a);
+    std::swap(a, b);
+    if (matrix) {
+      matrix->leftMultiply({0, 1, 1, -quotient});
+    }
+    return;
+  }
+  bigint_detail::ScratchArena& arena = bigint_detail::scratch();
+  bigint_detail::ScratchArena::Frame frame(arena);
+  bigint_detail::Limb* padded = arena.alloc(n);
+  bigint_detail::Limb* x = arena.alloc(n);
+  bigint_detail::Limb* y = arena.alloc(n);
+  std::copy(b.digits_.begin(), b.digits_.end(), padded);
+  std::fill(padded + m, padded + n, 0);
+  bigint_detail::applyCofactors(a.digits_.data(), padded, n, f.a, f.b, x);
+  bigint_detail::applyCofactors(a.digits_.data(), padded, n, f.c, f.d, y);
+  a.assign(x, n, false);
+  b.assign(y, n, false);
+  if (matrix) {
+    matrix->leftMultiply({f.a, f.b, f.c, f.d});
   }
 }
 
-BigInteger::BigInteger(const BigInteger& other,
-                       bool negative) {  // copy constructor
-  std::copy(other.digits_.begin(), other.digits_.end(),
-            std::back_inserter(digits_));
-  negative_ = negative;
-  size_ = other.size_;
-}
-
-void parseString(std::string str, std::vector<u_int64_t>& dest) {
-  std::reverse(str.begin(), str.end());
-  u_int64_t buffer = 0;
-  size_t pos = 0;
-  size_t power = 1;
-  for (size_t i = 0; i < str.length(); ++i) {
-    if ((i % BASE_LENGTH == 0) && i > 0) {
-      dest[pos++] = buffer;
-      buffer = 0;
-      power = 1;
+void BigInteger::halfGcd(BigInteger& a, BigInteger& b, GcdMatrix* matrix) {
+  size_t stop = a.len() / 2 + 1;
+  while (b.len() > stop) {
+    size_t n = a.len();
+    if (n < std::max<size_t>(BigIntegerTuning::half_gcd_threshold, 2)) {
+      gcdStep(a, b, matrix);
+      continue;
     }
-    if (str[i] != '-') {
-      buffer += (str[i] - '0') * power;
-      power *= 10;
+    // Reduce the leading limbs from p on; about half of their quotients
+    // match those of a and b. After the first round p = 2 * stop - n aims
+    // the reduction at `stop` directly.
+    size_t p = std::max(2 * stop - n, n / 2);
+    BigInteger high_a, high_b;
+    high_a.assign(a.digits_.data() + p, n - p, false);
+    high_b.assign(b.digits_.data() + p, b.len() - p, false);
+    GcdMatrix step;
+    halfGcd(high_a, high_b, &step);
+    BigInteger next_a = lazy(step.m00) * a + lazy(step.m01) * b;
+    BigInteger next_b = lazy(step.m10) * a + lazy(step.m11) * b;
+    // The truncated quotients may overshoot; any unimodular step keeps the
+    // gcd, so restore a >= b >= 0 and adjust the matrix to match.
+    if (next_a.isNegative()) {
+      next_a = -next_a;
+      step.m00 = -step.m00;
+      step.m01 = -step.m01;
+    }
+    if (next_b.isNegative()) {
+      next_b = -next_b;
+      step.m10 = -step.m10;
+      step.m11 = -step.m11;
+    }
+    if (next_a < next_b) {
+      std::swap(next_a, next_b);
+      std::swap(step.m00, step.m10);
+      std::swap(step.m01, step.m11);
+    }
+    a = std::move(next_a);
+    b = std::move(next_b);
+    if (matrix) {
+      matrix->leftMultiply(step);
+    }
+    if (a.len() == n && b) {
+      gcdStep(a, b, matrix);
     }
   }
-  if (buffer) {
-    dest[pos] = buffer;
-    buffer = 0;
+}
+
+// ==============Powers and roots==============
+
+void BigInteger::shiftLimbs(size_t count) {
+  if (!count || !*this) {
+    return;
   }
+  size_t n = len();
+  digits_.resize(n + count);
+  bigint_detail::Limb* limbs = digits_.data();
+  std::copy_backward(limbs, limbs + n, limbs + n + count);
+  std::fill(limbs, limbs + count, 0);
 }
 
-std::string BigInteger::toString() const {
-  std::string s;
-  size_t size = digits_.size();
-  if (negative_ && !(size == 1 && digits_[0] == 0)) {
-    s += "-";
+BigInteger pow(const BigInteger& x, uint64_t k) {
+  if (k == 0) {
+    return 1;
+  }
+  if (!x) {
+    return 0;
   }
-  for (size_t i = 0; i < size; ++i) {
-    std::string tmp = std::to_string(digits_[size - i - 1]);
-    if (i > 0) {
-      tmp = std::string(BASE_LENGTH - tmp.length(), '0') + tmp;
+  // x = core * radix^zeros, so x^k = core^k * radix^(zeros * k).
+  size_t zeros = 0;
+  while (x[zeros] == 0) {
+    ++zeros;
+  }
+  size_t core_len = x.len() - zeros;
+  BigInteger result;
+  size_t t;
+  if (core_len == 1 && bigint_detail::isDigitPower(x[zeros], t)) {
+    size_t digits = t * k;
+    const bigint_detail::Limb top =
+        bigint_detail::digitPower(digits % bigint_detail::RADIX_DIGITS);
+    result.assign(&top, 1, false);
+    result.shiftLimbs(zeros * k + digits / bigint_detail::RADIX_DIGITS);
+  } else {
+    BigInteger core;
+    core.assign(x.digits_.data() + zeros, core_len, false);
+    result = core;
+    for (int bit = 62 - __builtin_clzll(k); bit >= 0; --bit) {
+      result *= result;
+      if (k >> bit & 1) {
+        result *= core;
+      }
     }
-    s += tmp;
+    result.shiftLimbs(zeros * k);
   }
-  return s;
+  result.setSign(x.isNegative() && k % 2);
+  return result;
 }
 
-bool operator<(const BigInteger& lhs, const BigInteger& rhs) {
-  if (lhs.isNegative() && !rhs.isNegative()) {
-    return true;
+// log2 |x| for a nonzero x from its two leading limbs.
+inline double log2Magnitude(const BigInteger& x) {
+  size_t n = x.len();
+  if (n == 1) {
+    return std::log2(static_cast<double>(x[0]));
   }
-  if (!lhs.isNegative() && rhs.isNegative()) {
-    return false;
+  double top = x[n - 1] * bigint_detail::LIMB_RADIX + x[n - 2];
+  return std::log2(top) + (n - 2) * std::log2(bigint_detail::LIMB_RADIX);
+}
+
+BigInteger iroot(const BigInteger& x, uint64_t k) {
+  if (k == 0 || (x.isNegative() && k % 2 == 0)) {
+    return 0;
   }
-  if (lhs.len() < rhs.len()) {
-    return !lhs.isNegative();
+  if (x.isNegative()) {
+    return -iroot(-x, k);
   }
-  if (lhs.len() > rhs.len()) {
-    return lhs.isNegative();
+  if (k == 1 || x < 2) {
+    return x;
   }
-  for (size_t i = lhs.len(); i > 0; --i) {
-    if (lhs[i - 1] < rhs[i - 1]) {
-      return !lhs.isNegative();
-    }
-    if (lhs[i - 1] > rhs[i - 1]) {
-      return lhs.isNegative();
+  double bits = log2Magnitude(x);
+  if (bits < k - 1.0) {
+    return 1;
+  }
+  // Start above the root: from the root of the leading half of the limbs
+  // when there are enough of them, otherwise from a power of two.
+  BigInteger y;
+  size_t n = x.len();
+  size_t h = n / (2 * k);
+  if (h == 0) {
+    y = pow(BigInteger(2), static_cast<uint64_t>(bits / k) + 2);
+  } else {
+    // x < (high + 1) * radix^(k * h), and (root(high) + 1)^k > high.
+    BigInteger high;
+    high.assign(x.digits_.data() + k * h, n - k * h, false);
+    y = iroot(high, k) + 1;
+    y.shiftLimbs(h);
+  }
+  // From above, Newton's iteration decreases monotonically to the root.
+  int64_t degree = static_cast<int64_t>(k);
+  while (true) {
+    BigInteger next = x / pow(y, k - 1);
+    addmul_word(next, y, degree - 1);
+    next /= degree;
+    if (next >= y) {
+      return y;
     }
+    y = std::move(next);
   }
-  return (!lhs.isNegative() ? false : true);
 }
 
-bool operator>(const BigInteger& lhs, const BigInteger& rhs) {
-  return rhs < lhs;
-}
-
-bool operator<=(const BigInteger& lhs, const BigInteger& rhs) {
-  return !(lhs > rhs);
-}
+// floor(sqrt(x)); zero for negative x.
+inline BigInteger isqrt(const BigInteger& x) { return iroot(x, 2); }
 
-bool operator>=(const BigInteger& lhs, const BigInteger& rhs) {
-  return !(lhs < rhs);
-}
+// ==============Products==============
+// Multi-operand products multiply in a balanced tree, so the operands of
+// each multiplication have similar lengths and reach the fast kernels;
+// folding with *= keeps one side a single limb and is quadratic.
+namespace bigint_detail {
 
-bool operator==(const BigInteger& lhs, const BigInteger& rhs) {
-  if (lhs.len() != rhs.len()) {
-    return false;
+// Multiplies values pairwise, level by level, into values[0].
+inline BigInteger productTree(std::vector<BigInteger>& values) {
+  size_t n = values.size();
+  if (n == 0) {
+    return 1;
   }
-  for (size_t i = lhs.len(); i > 0; --i) {
-    if (lhs[i - 1] != rhs[i - 1]) {
-      return false;
+  while (n > 1) {
+    size_t half = 0;
+    for (size_t i = 0; i + 1 < n; i += 2) {
+      values[half++] = values[i] * values[i + 1];
     }
+    if (n % 2) {
+      values[half++] = std::move(values[n - 1]);
+    }
+    n = half;
   }
-  return lhs.isNegative() == rhs.isNegative();
+  return std::move(values[0]);
 }
 
-bool operator!=(const BigInteger& lhs, const BigInteger& rhs) {
-  return !(lhs == rhs);
-}
+// Word factors packed into as few BigInteger leaves as fit, for the tree.
+class FactorList {
+ public:
+  void push(uint64_t factor) {
+    if (factor > static_cast<uint64_t>(INT64_MAX)) {
+      // Past the int64_t constructor: assemble it from 32-bit halves.
+      BigInteger high(static_cast<int64_t>(factor >> 32));
+      leaves_.push_back(high * (int64_t(1) << 32) +
+                        static_cast<int64_t>(factor & 0xffffffff));
+      return;
+    }
+    if (word_ > INT64_MAX / static_cast<int64_t>(factor)) {
+      leaves_.emplace_back(word_);
+      word_ = 1;
+    }
+    word_ *= factor;
+  }
 
-BigInteger operator+(BigInteger lhs, const BigInteger& right);
+  BigInteger product() {
+    if (word_ > 1) {
+      leaves_.emplace_back(word_);
+      word_ = 1;
+    }
+    return productTree(leaves_);
+  }
 
-BigInteger operator-(BigInteger lhs, const BigInteger& rhs);
+ private:
+  std::vector<BigInteger> leaves_;
+  int64_t word_ = 1;
+};
 
-BigInteger operator+(BigInteger lhs, const BigInteger& rhs) {
-  if (lhs.isNegative()) {
-    if (rhs.isNegative())
-      return -(-lhs + (-rhs));
-    else
-      return rhs - (-lhs);
-  } else if (rhs.isNegative())
-    return lhs - (-rhs);
-  if (lhs.len() < rhs.len()) {
-    lhs.digits_.resize(rhs.len());
+// Odd primes up to n, by a sieve over the odd numbers.
+inline std::vector<uint64_t> oddPrimes(uint64_t n) {
+  std::vector<uint64_t> primes;
+  if (n < 3) {
+    return primes;
   }
-  size_t sz = rhs.len();
-  for (size_t i = 0; i < sz; i++) {
-    lhs[i] += rhs[i];
+  std::vector<bool> composite((n - 1) / 2);  // composite[i] is 2i + 3
+  for (size_t i = 0; i < composite.size(); ++i) {
+    if (composite[i]) {
+      continue;
+    }
+    uint64_t p = 2 * i + 3;
+    primes.push_back(p);
+    for (uint64_t j = p * p; j <= n; j += 2 * p) {
+      composite[(j - 3) / 2] = true;
+    }
   }
-  lhs.pushOverflow();
-  lhs.trimLeft();
-  return lhs;
+  return primes;
 }
 
-BigInteger operator-(BigInteger lhs, const BigInteger& rhs) {
-  if (rhs.isNegative())
-    return lhs + (-rhs);
-  else if (lhs.isNegative())
-    return -(-lhs + rhs);
-  else if (lhs < rhs)
-    return -(rhs - lhs);
-  size_t carry = 0;
-  size_t new_carry = 0;
-  if (lhs.len() < rhs.len()) {
-    lhs.digits_.resize(rhs.len());
-  }
-
-  for (size_t i = 0; i < rhs.len(); ++i) {
-    new_carry = 0;
-    if (lhs[i] < carry + rhs[i]) {
-      lhs[i] += BASE;
-      new_carry = 1;
-    }
-    lhs[i] -= carry + rhs[i];
-    carry = new_carry;
-  }
-  if (carry != 0) {
-    if (lhs.len() > rhs.len()) {
-      size_t i = rhs.len();
-      while (carry != 0 && i < lhs.len()) {
-        new_carry = 0;
-        if (lhs[i] < carry) {
-          lhs[i] += BASE;
-          new_carry = 1;
-        }
-        lhs[i] -= carry;
-        carry = new_carry;
-        ++i;
+// Odd part of n!, from n! = (n/2)!^2 * swing(n) where the swing
+// n! / (n/2)!^2 has the prime p to the power sum_i (n / p^i) mod 2.
+inline BigInteger oddFactorial(uint64_t n,
+                               const std::vector<uint64_t>& primes) {
+  if (n < 3) {
+    return 1;
+  }
+  BigInteger half = square(oddFactorial(n / 2, primes));
+  FactorList swing;
+  for (uint64_t p : primes) {
+    if (p > n) {
+      break;
+    }
+    uint64_t power = 1;
+    for (uint64_t q = n / p; q; q /= p) {
+      if (q & 1) {
+        power *= p;
       }
     }
-    carry = 0;
+    if (power > 1) {
+      swing.push(power);
+    }
   }
-  lhs.trimLeft();
-  return lhs;
+  return half * swing.product();
 }
 
-BigInteger& BigInteger::operator+=(const BigInteger& other) {
-  *this = (*this) + other;
-  return *this;
-}
+}  // namespace bigint_detail
 
-BigInteger& BigInteger::operator-=(const BigInteger& other) {
-  *this = (*this) - other;
-  return *this;
+template <class Iterator>
+BigInteger product(Iterator first, Iterator last) {
+  std::vector<BigInteger> values(first, last);
+  return bigint_detail::productTree(values);
 }
 
-BigInteger operator*(const BigInteger& a, int64_t n) {
-  if (!a || !n) {
-    return BigInteger(0);
-  }
-  int64_t rest = 0;
-  BigInteger product(0, a.len());
-  product.negative_ = a.negative_ ^ (n < 0);
-  if (n < 0) {
-    n *= -1;
-  }
-  for (size_t i = 0; i < a.len(); ++i) {
-    product[i] = a[i] * n + rest;
-    rest = product[i] / BASE;
-    product[i] -= rest * BASE;
-  }
-  if (rest) {
-    product.digits_.resize(product.len() + 1);
-    product[product.len() - 1] += rest;
-  }
+// Product of a container's elements; one for an empty range.
+template <class Range>
+BigInteger product(const Range& values) {
+  return product(std::begin(values), std::end(values));
+}
 
-  product.trimLeft();
-  return product;
+inline BigInteger product(std::initializer_list<BigInteger> values) {
+  return product(values.begin(), values.end());
 }
 
-BigInteger& BigInteger::operator*=(const int64_t number) {
-  *this = (*this) * number;
-  return *this;
+// n! by prime swing: the odd part from prime powers, then 2^(n - popcount n).
+inline BigInteger factorial(uint64_t n) {
+  BigInteger odd = bigint_detail::oddFactorial(n, bigint_detail::oddPrimes(n));
+  return odd * pow(BigInteger(2), n - __builtin_popcountll(n));
 }
 
-BigInteger operator*(const BigInteger& lhs, const BigInteger& rhs) {
-  if (!lhs || !rhs) {
-    return BigInteger(0);
+// C(n, k), zero when k > n.
+inline BigInteger binomial(uint64_t n, uint64_t k) {
+  if (k > n) {
+    return 0;
+  }
+  k = std::min(k, n - k);
+  if (k == 0) {
+    return 1;
+  }
+  bigint_detail::FactorList factors;
+  if (n / k >= 64) {
+    // Few factors against a long sieve: n (n-1) ... (n-k+1) / k!.
+    for (uint64_t i = 0; i < k; ++i) {
+      factors.push(n - i);
+    }
+    return factors.product() / factorial(k);
   }
-  BigInteger product(0, lhs.len() + rhs.len() + 1);
-  size_t sz1 = lhs.len();
-  size_t sz2 = rhs.len();
-  for (size_t i = 0; i < sz1; ++i) {
-    int64_t rest = 0;
-    for (size_t j = 0; j < sz2; ++j) {
-      product[i + j] += lhs[i] * rhs[j] + rest;
-      rest = product[i + j] / BASE;
-      product[i + j] -= rest * BASE;
+  // Kummer: p divides C(n, k) once per borrow in k + (n - k) base p.
+  std::vector<uint64_t> primes = bigint_detail::oddPrimes(n);
+  primes.insert(primes.begin(), 2);
+  for (uint64_t p : primes) {
+    uint64_t power = 1;
+    for (uint64_t a = n, b = k, c = n - k; a;) {
+      a /= p;
+      b /= p;
+      c /= p;
+      for (uint64_t e = a - b - c; e; --e) {
+        power *= p;
+      }
     }
-    if (rest) {
-      product[i + sz2] += rest;
+    if (power > 1) {
+      factors.push(power);
     }
   }
-  product.trimLeft();
-  product.negative_ = lhs.negative_ ^ rhs.negative_;
-  return product;
+  return factors.product();
 }
 
-BigInteger& BigInteger::operator*=(const BigInteger& rhs) {
-  *this = *this * rhs;
-  return *this;
-}
+// ==============BigModulus==============
+// A fixed modulus with its Barrett reciprocal, for loops that reduce many
+// values by the same divisor: each reduction then costs two multiplications
+// instead of a long division. Results lie in [0, |modulus|); a zero modulus
+// makes them all zero.
 
-BigInteger operator/(BigInteger a, const int64_t& n) {
-  int rest = 0;
-  BigInteger product(0, a.len());
-  for (size_t i = a.len(); i > 0; i--) {
-    int64_t cur = rest * BASE + a[i - 1];
-    product[i - 1] = cur / n;
-    rest = cur % n;
-  }
-  product.negative_ = a.negative_ ^ (n < 0);
-  product.trimLeft();
-  return product;
-  // return a / BigInteger(n);
-}
+class BigModulus {
+ public:
+  explicit BigModulus(const BigInteger& modulus);
 
-BigInteger& BigInteger::operator/=(const int64_t& n) {
-  *this = *this / n;
-  return *this;
-}
-/*
-int64_t operator%(BigInteger a, const int64_t& n) {
-  int64_t rest = 0;
-  BigInteger mod;
-  for (size_t i = SIZE; i > 0; i--) {
-    int64_t cur = rest * BASE + a[i - 1];
-    mod[i - 1] = cur / n;
-    rest = cur % n;
-  }
-  rest = (a.isNegative() ^ (n < 0)) ? -rest : rest;
-  return rest;
-  return a % BigInteger(n);
-}
-*/
-BigInteger operator/(const BigInteger& a, const BigInteger& b) {
-  if (!a) return BigInteger(0);
-  if (!b) return BigInteger(0);
-  if (b.abs() > a.abs()) {
-    return BigInteger(0);
-  }
-  BigInteger abs_b = b.abs();
-
-  BigInteger fraction(0, a.len() + 1);
-  BigInteger curValue(0);
-  size_t sz1 = a.len();
-  for (size_t i = sz1; i > 0; i--) {
-    curValue.digits_.push_back(0);
-    curValue.shiftLeft();
-    curValue.trimLeft();
-    curValue[0] = a[i - 1];
-    ++curValue.size_;
-    int64_t x = 0;
-    int64_t l = 0, r = BASE;
-    while (l <= r) {
-      int64_t m = (l + r) >> 1;
-      BigInteger cur = abs_b * m;
-      if (cur <= curValue) {
-        x = m;
-        l = m + 1;
-      } else
-        r = m - 1;
-    }
-    fraction[i - 1] = x;
-    curValue = curValue - abs_b * x;
-  }
-  fraction.negative_ = a.negative_ ^ b.negative_;
-  fraction.trimLeft();
-  return fraction;
-}
+  const BigInteger& modulus() const { return modulus_; }
 
-BigInteger& BigInteger::operator/=(const BigInteger& b) {
-  *this = *this / b;
-  return *this;
-}
+  // x mod |modulus|, also for negative x.
+  BigInteger reduce(const BigInteger& x) const;
 
-BigInteger operator%(const BigInteger& a, const BigInteger& b) {
-  if (a < b) {
-    return BigInteger(a, a.isNegative());
-  }
-  if (a == 0 || b == 0) {
-    return BigInteger(0);
+  BigInteger mulmod(const BigInteger& a, const BigInteger& b) const;
+
+  // Reduced operands take a single comparison; others are reduced first.
+  BigInteger addmod(const BigInteger& a, const BigInteger& b) const;
+
+  BigInteger submod(const BigInteger& a, const BigInteger& b) const;
+
+ private:
+  bool isReduced(const BigInteger& x) const {
+    return !x.isNegative() && x < modulus_;
   }
-  /*
-  BigInteger rest(0, a.size_);
-  BigInteger curValue;
-
-  BigInteger abs_b = b.abs();
-  for (size_t i = a.size_; i > 0; i--) {
-    curValue.shiftLeft();
-    curValue.digits_.push_back(a[i - 1]);
-    ++curValue.size_;
-    int64_t x = 0;
-    int64_t l = 0, r = BASE;
-    while (l <= r) {
-      int64_t m = (l + r) >> 1;
-      BigInteger cur = abs_b * m;
-      if (cur <= curValue) {
-        x = m;
-        l = m + 1;
-      } else
-        r = m - 1;
-    }
-    rest[i - 1] = x;
-    curValue = curValue - abs_b * x;
-  }
-  curValue.negative_ = a.negative_;
-  curValue.trimLeft();
-  return curValue;
-  */
-  return a - b * (a / b);
-}
-/*
-BigInteger operator%(const BigInteger& a, const BigInteger& b) {
-  return a - b * (a / b);
-}
-*/
-BigInteger& BigInteger::operator%=(const BigInteger& a) {
-  *this = *this % a;
-  return *this;
-}
 
-BigInteger& BigInteger::operator++() {
-  *this += 1;
-  return *this;
+  // x[0..len) mod |modulus| with the given sign, as a BigInteger.
+  BigInteger reduceLimbs(const bigint_detail::Limb* x, size_t len,
+                         bool negative) const;
+
+  BigInteger modulus_;
+  std::vector<bigint_detail::Limb> reciprocal_;
+};
+
+BigModulus::BigModulus(const BigInteger& modulus) : modulus_(modulus, false) {
+  if (!modulus_) {
+    return;
+  }
+  size_t n = modulus_.len();
+  reciprocal_.assign(n + 2, 0);
+  reciprocal_.resize(bigint_detail::barrettReciprocal(
+      modulus_.digits_.data(), n, reciprocal_.data()));
 }
 
-BigInteger BigInteger::operator++(int) {
-  BigInteger result(*this);
-  *this += 1;
+BigInteger BigModulus::reduceLimbs(const bigint_detail::Limb* x, size_t len,
+                                   bool negative) const {
+  if (!modulus_) {
+    return 0;
+  }
+  bigint_detail::ScratchArena& arena = bigint_detail::scratch();
+  bigint_detail::ScratchArena::Frame frame(arena);
+  size_t n = modulus_.len();
+  const bigint_detail::Limb* m = modulus_.digits_.data();
+  bigint_detail::Limb* r = arena.alloc(n);
+  bigint_detail::barrettReduce(x, len, m, n, reciprocal_.data(),
+                               reciprocal_.size(), r);
+  if (negative && bigint_detail::trimmed(r, n)) {
+    bigint_detail::subLimbs(m, n, r, n, r);
+  }
+  BigInteger result;
+  result.assign(r, n, false);
   return result;
 }
 
-BigInteger& BigInteger::operator--() {
-  *this -= BigInteger(1);
-  return *this;
+BigInteger BigModulus::reduce(const BigInteger& x) const {
+  if (isReduced(x)) {
+    return x;
+  }
+  return reduceLimbs(x.digits_.data(), x.len(), x.isNegative());
 }
 
-BigInteger BigInteger::operator--(int) {
-  BigInteger tmp(*this);
-  *this -= BigInteger(1);
-  return tmp;
+BigInteger BigModulus::mulmod(const BigInteger& a, const BigInteger& b) const {
+  bigint_detail::ScratchArena& arena = bigint_detail::scratch();
+  bigint_detail::ScratchArena::Frame frame(arena);
+  size_t len = a.len() + b.len();
+  bigint_detail::Limb* product = arena.alloc(len);
+  bigint_detail::mul(a.digits_.data(), a.len(), b.digits_.data(), b.len(),
+                     product);
+  return reduceLimbs(product, len, a.isNegative() ^ b.isNegative());
 }
 
-BigInteger::operator bool() const {
-  return (this->len() > 1) || ((this->len() == 1) && (this->digits_[0] != 0));
+BigInteger BigModulus::addmod(const BigInteger& a, const BigInteger& b) const {
+  if (!isReduced(a) || !isReduced(b)) {
+    return reduce(a + b);
+  }
+  BigInteger sum = a;
+  sum += b;
+  if (sum >= modulus_) {
+    sum -= modulus_;
+  }
+  return sum;
 }
 
-BigInteger::operator double() const {
-  ssize_t num = 0;
-  for (size_t i = 0; i < size_; ++i) {
-    num *= BASE;
-    num += digits_[size_ - 1 - i];
+BigInteger BigModulus::submod(const BigInteger& a, const BigInteger& b) const {
+  if (!isReduced(a) || !isReduced(b)) {
+    return reduce(a - b);
+  }
+  BigInteger difference = a;
+  difference -= b;
+  if (difference.isNegative()) {
+    difference += modulus_;
   }
-  return num;
+  return difference;
 }
 
-size_t BigInteger::len() const { return digits_.size(); }
+// ==============MontgomeryContext==============
+// Precomputation for modular exponentiation by one modulus, shared across
+// powmod calls. Moduli coprime to the limb radix (odd ones in binary builds,
+// those coprime to 10 in decimal ones) multiply in Montgomery form; any
+// other modulus falls back to Barrett reduction.
 
-BigInteger operator""_bi(unsigned long long number) {
-  return BigInteger(number);
-}
+class MontgomeryContext {
+ public:
+  // A zero modulus makes every power zero; the sign of the modulus is
+  // ignored.
+  explicit MontgomeryContext(const BigInteger& modulus);
 
-BigInteger operator""_bi(const char* number, size_t) {
-  return BigInteger(std::string(number));
-}
+  const BigInteger& modulus() const { return modulus_; }
 
-std::istream& operator>>(std::istream& in, BigInteger& bi) {
-  std::string buffer;
-  in >> buffer;
-  bi = BigInteger(buffer);
-  return in;
-}
+  // base^exponent mod |modulus| in [0, |modulus|); negative exponents yield
+  // zero.
+  BigInteger powmod(const BigInteger& base, const BigInteger& exponent) const;
 
-std::ostream& operator<<(std::ostream& out, const BigInteger& bi) {
-  out << bi.toString();
-  return out;
-}
+ private:
+  BigInteger modulus_;
+  bool montgomery_ = false;
+  bigint_detail::Limb inverse_ = 0;
+  std::vector<bigint_detail::Limb> one_;         // radix^n mod m, or 1
+  std::vector<bigint_detail::Limb> converter_;   // radix^2n mod m
+  std::vector<bigint_detail::Limb> reciprocal_;  // floor(radix^2n / m)
+};
 
-void BigInteger::pushOverflow() {
-  size_t size = digits_.size();
-  if (size > 0) {
-    for (size_t i = 0; i < size - 1; ++i) {
-      while (digits_[i] >= BASE) {
-        digits_[i] -= BASE;
-        ++digits_[i + 1];
-      }
-    }
+MontgomeryContext::MontgomeryContext(const BigInteger& modulus)
+    : modulus_(modulus, false) {
+  size_t n = modulus_.len();
+  const bigint_detail::Limb* m = modulus_.digits_.data();
+  if (!modulus_) {
+    return;
   }
-  if (digits_[size - 1] >= BASE) {
-    digits_.push_back(1);
-    digits_[size - 1] -= BASE;
+  one_.assign(n, 0);
+  montgomery_ = bigint_detail::coprimeToRadix(m[0]);
+  if (!montgomery_) {
+    if (modulus_ != 1) {
+      one_[0] = 1;
+    }
+    reciprocal_.assign(n + 2, 0);
+    size_t len = bigint_detail::barrettReciprocal(m, n, reciprocal_.data());
+    reciprocal_.resize(len);
+    return;
   }
+  inverse_ = bigint_detail::montgomeryInverse(m[0]);
+  std::vector<bigint_detail::Limb> power(2 * n + 1, 0);
+  power[n] = 1;
+  bigint_detail::divmod(power.data(), n + 1, m, n, nullptr, one_.data());
+  power[n] = 0;
+  power[2 * n] = 1;
+  converter_.assign(n, 0);
+  bigint_detail::divmod(power.data(), 2 * n + 1, m, n, nullptr,
+                        converter_.data());
 }
 
-void BigInteger::shiftLeft() {
-  size_ = digits_.size();
-  if (digits_.size() > 1 && digits_[size_ - 1]) {
-    digits_.resize(size_ + 1);
-    digits_[size_] = digits_[size_ - 1];
-    ++size_;
+BigInteger MontgomeryContext::powmod(const BigInteger& base,
+                                     const BigInteger& exponent) const {
+  if (!modulus_ || exponent.isNegative()) {
+    return 0;
+  }
+  bigint_detail::ScratchArena& arena = bigint_detail::scratch();
+  bigint_detail::ScratchArena::Frame frame(arena);
+  size_t n = modulus_.len();
+  const bigint_detail::Limb* m = modulus_.digits_.data();
+  bigint_detail::Limb* x = arena.alloc(n);
+  bigint_detail::Limb* result = arena.alloc(n);
+  std::fill(x, x + n, 0);
+  size_t len = base.len();
+  if (bigint_detail::compare(base.digits_.data(), len, m, n) < 0) {
+    std::copy(base.digits_.begin(), base.digits_.end(), x);
+  } else {
+    bigint_detail::divmod(base.digits_.data(), len, m, n, nullptr, x);
+  }
+  if (base.isNegative() && bigint_detail::trimmed(x, n)) {
+    bigint_detail::subLimbs(m, n, x, n, x);
   }
+  if (montgomery_) {
+    bigint_detail::MontgomeryRing ring{m, n, inverse_};
+    ring.multiply(x, converter_.data(), x);
+    bigint_detail::powWindow(ring, x, one_.data(), exponent.digits_.data(),
+                             exponent.len(), result);
+    std::fill(x, x + n, 0);
+    x[0] = 1;
+    ring.multiply(result, x, result);
+  } else {
+    bigint_detail::BarrettRing ring{m, n, reciprocal_.data(),
+                                    reciprocal_.size()};
+    bigint_detail::powWindow(ring, x, one_.data(), exponent.digits_.data(),
+                             exponent.len(), result);
+  }
+  BigInteger power;
+  power.assign(result, n, false);
+  return power;
+}
 
-  for (size_t i = digits_.size(); i > 1; --i) digits_[i - 1] = digits_[i - 2];
+// base^exponent mod |modulus|; see MontgomeryContext, which a loop over one
+// modulus should keep around.
+inline BigInteger powmod(const BigInteger& base, const BigInteger& exponent,
+                         const BigInteger& modulus) {
+  return MontgomeryContext(modulus).powmod(base, exponent);
 }
 
 class Rational {
  private:
-  BigInteger numerator_;
-  BigInteger denominator_;
-  void shift();
+  // Mutable so that const observers can reduce a lazily kept fraction; the
+  // value never changes.
+  mutable BigInteger numerator_;
+  mutable BigInteger denominator_;
+  mutable bool reduced_ = true;
+  void shift() const;
+
+  void normalize() const {
+    if (!reduced_) {
+      shift();
+    }
+  }
+
+  // Called on every fresh result: reduces it now unless the lazy mode (see
+  // BigIntegerTuning::lazy_rational_limbs) lets it wait.
+  void settle();
+
+  // a + b or a - b for reduced operands (Knuth, TAOCP 4.5.1): only the gcd
+  // of the denominators and a gcd against it are needed to reduce the sum.
+  static Rational sum(const Rational& a, const Rational& b, bool subtract);
+
+  // -1, 0 or 1 as a is less than, equal to or greater than b. Signs and the
+  // leading limbs settle most pairs; the rest take one cross-multiplication.
+  static int compare(const Rational& a, const Rational& b);
 
  public:
   Rational() : Rational(0){};
@@ -692,10 +3638,11 @@ Rational::Rational(const BigInteger& num, const BigInteger& denom)
     numerator_ = num;
   }
   denominator_ = denom >= 0 ? denom : -denom;
-  shift();
+  settle();
 };
 
 std::string Rational::toString() const {
+  normalize();
   if (denominator_ == 1) {
     return numerator_.toString();
   } else {
@@ -704,6 +3651,7 @@ std::string Rational::toString() const {
 }
 
 std::string Rational::asDecimal(size_t precision) const {
+  normalize();
   BigInteger quotinent;
   BigInteger numerator;
   std::string decimal;
@@ -712,7 +3660,7 @@ std::string Rational::asDecimal(size_t precision) const {
     if (numerator_.isNegative()) {
       result += '-';
     }
-    BigInteger power(decPow(precision));
+    BigInteger power = pow(BigInteger(10), precision);
     numerator = numerator_.abs() * power;
     quotinent = (numerator / denominator_);
     decimal = quotinent.toString();
@@ -731,45 +3679,142 @@ std::string Rational::asDecimal(size_t precision) const {
   return result;
 }
 
-void Rational::shift() {
-  BigInteger x = numerator_ >= 0 ? numerator_ : -numerator_;
-  BigInteger y = denominator_ >= 0 ? denominator_ : -denominator_;
-  while (x != 0 && y != 0) {
-    if (x > y) {
-      x = x % y;
-    } else {
-      y = y % x;
-    }
+void Rational::shift() const {
+  reduced_ = true;
+  BigInteger divisor = gcd(numerator_, denominator_);
+  if (!divisor || divisor == 1) {
+    return;
   }
-  numerator_ /= x + y;
-  denominator_ /= x + y;
+  numerator_ /= divisor;
+  denominator_ /= divisor;
   // numerator_.setSign(numerator_.isNegative() ^ denominator_.isNegative());
   // denominator_.setSign(false);
 }
 
+void Rational::settle() {
+  size_t limit = BigIntegerTuning::lazy_rational_limbs;
+  reduced_ = false;
+  if (!limit || numerator_.len() + denominator_.len() > limit) {
+    shift();
+  }
+}
+
 Rational Rational::operator-() const {
   Rational neg(*this);
   neg.numerator_.invert();
   return neg;
 }
 
+Rational Rational::sum(const Rational& a, const Rational& b, bool subtract) {
+  Rational result;
+  if (BigIntegerTuning::lazy_rational_limbs) {
+    if (a.denominator_ == b.denominator_) {
+      result.numerator_ = subtract ? a.numerator_ - b.numerator_
+                                   : a.numerator_ + b.numerator_;
+      result.denominator_ = a.denominator_;
+    } else {
+      result.numerator_ = a.numerator_ * b.denominator_;
+      if (subtract) {
+        submul(result.numerator_, b.numerator_, a.denominator_);
+      } else {
+        addmul(result.numerator_, b.numerator_, a.denominator_);
+      }
+      result.denominator_ = a.denominator_ * b.denominator_;
+    }
+    result.settle();
+    return result;
+  }
+  a.normalize();
+  b.normalize();
+  BigInteger d1 = gcd(a.denominator_, b.denominator_);
+  if (d1 == 1) {
+    result.numerator_ = a.numerator_ * b.denominator_;
+    if (subtract) {
+      submul(result.numerator_, b.numerator_, a.denominator_);
+    } else {
+      addmul(result.numerator_, b.numerator_, a.denominator_);
+    }
+    result.denominator_ = a.denominator_ * b.denominator_;
+    return result;
+  }
+  BigInteger a_part = a.denominator_ / d1;
+  BigInteger b_part = b.denominator_ / d1;
+  BigInteger t = a.numerator_ * b_part;
+  if (subtract) {
+    submul(t, b.numerator_, a_part);
+  } else {
+    addmul(t, b.numerator_, a_part);
+  }
+  if (!t) {
+    return result;
+  }
+  BigInteger d2 = gcd(t, d1);
+  if (d2 == 1) {
+    result.numerator_ = std::move(t);
+    result.denominator_ = a_part * b.denominator_;
+  } else {
+    result.numerator_ = t / d2;
+    result.denominator_ = a_part * (b.denominator_ / d2);
+  }
+  return result;
+}
+
 Rational operator+(const Rational& a, const Rational& b) {
-  return Rational(a.numerator_ * b.denominator_ + b.numerator_ * a.denominator_,
-                  a.denominator_ * b.denominator_);
+  return Rational::sum(a, b, false);
 }
 
 Rational operator-(const Rational& a, const Rational& b) {
-  return Rational(
-      ((a.numerator_ * b.denominator_) - (b.numerator_ * a.denominator_)),
-      (a.denominator_ * b.denominator_));
+  return Rational::sum(a, b, true);
 }
 
+// Cross-cancelling first (Knuth, TAOCP 4.5.1) leaves the product reduced.
 Rational operator*(const Rational& a, const Rational& b) {
-  return Rational(a.numerator_ * b.numerator_, a.denominator_ * b.denominator_);
+  Rational result;
+  if (!a.numerator_ || !b.numerator_) {
+    return result;
+  }
+  if (BigIntegerTuning::lazy_rational_limbs) {
+    result.numerator_ = a.numerator_ * b.numerator_;
+    result.denominator_ = a.denominator_ * b.denominator_;
+    result.settle();
+    return result;
+  }
+  a.normalize();
+  b.normalize();
+  BigInteger d1 = gcd(a.numerator_, b.denominator_);
+  BigInteger d2 = gcd(b.numerator_, a.denominator_);
+  result.numerator_ = (a.numerator_ / d1) * (b.numerator_ / d2);
+  result.denominator_ = (a.denominator_ / d2) * (b.denominator_ / d1);
+  return result;
 }
 
 Rational operator/(const Rational& a, const Rational& b) {
-  return Rational(a.numerator_ * b.denominator_, a.denominator_ * b.numerator_);
+  if (!a.numerator_ || !b.numerator_) {
+    return Rational(a.numerator_ * b.denominator_,
+                    a.denominator_ * b.numerator_);
+  }
+  Rational result;
+  if (BigIntegerTuning::lazy_rational_limbs) {
+    result.numerator_ = a.numerator_ * b.denominator_;
+    result.denominator_ = a.denominator_ * b.numerator_;
+    if (result.denominator_.isNegative()) {
+      result.numerator_.invert();
+      result.denominator_.invert();
+    }
+    result.settle();
+    return result;
+  }
+  a.normalize();
+  b.normalize();
+  BigInteger d1 = gcd(a.numerator_, b.numerator_);
+  BigInteger d2 = gcd(a.denominator_, b.denominator_);
+  result.numerator_ = (a.numerator_ / d1) * (b.denominator_ / d2);
+  result.denominator_ = (a.denominator_ / d2) * (b.numerator_ / d1);
+  if (result.denominator_.isNegative()) {
+    result.numerator_.invert();
+    result.denominator_.invert();
+  }
+  return result;
 }
 
 Rational& Rational::operator+=(const Rational& a) {
@@ -793,36 +3838,65 @@ Rational& Rational::operator/=(const Rational& a) {
 }
 
 Rational::operator double() {
+  normalize();
   return (static_cast<double>(numerator_) / static_cast<double>(denominator_));
 }
 
-bool operator<(const Rational& lhs, const Rational& rhs) {
-  if (lhs.isNegative() && !rhs.isNegative()) {
-    return true;
+int Rational::compare(const Rational& a, const Rational& b) {
+  int sign = !a.numerator_ ? 0 : a.isNegative() ? -1 : 1;
+  int other = !b.numerator_ ? 0 : b.isNegative() ? -1 : 1;
+  if (sign != other) {
+    return sign < other ? -1 : 1;
   }
-  if (!lhs.isNegative() && rhs.isNegative()) {
-    return false;
+  if (!sign) {
+    return 0;
   }
-
-  if (rhs.isNegative()) {
-    return -rhs < -lhs;
+  a.normalize();
+  b.normalize();
+  if (a.denominator_ == b.denominator_) {
+    if (a.numerator_ == b.numerator_) {
+      return 0;
+    }
+    return a.numerator_ < b.numerator_ ? -1 : 1;
   }
-  Rational quotinent = lhs / rhs;
-  return quotinent.numerator_ < quotinent.denominator_;
+  // Two leading limbs pin log2 of each side down far below this margin.
+  double estimate = log2Magnitude(a.numerator_) +
+                    log2Magnitude(b.denominator_) -
+                    log2Magnitude(b.numerator_) - log2Magnitude(a.denominator_);
+  if (estimate > 1e-6) {
+    return sign;
+  }
+  if (estimate < -1e-6) {
+    return -sign;
+  }
+  BigInteger lhs = a.numerator_ * b.denominator_;
+  BigInteger rhs = b.numerator_ * a.denominator_;
+  return lhs == rhs ? 0 : lhs < rhs ? -1 : 1;
+}
+
+bool operator<(const Rational& lhs, const Rational& rhs) {
+  return Rational::compare(lhs, rhs) < 0;
 }
 
-bool operator>(const Rational& lhs, const Rational& rhs) { return rhs < lhs; }
+bool operator>(const Rational& lhs, const Rational& rhs) {
+  return Rational::compare(lhs, rhs) > 0;
+}
 
 bool operator<=(const Rational& lhs, const Rational& rhs) {
-  return !(lhs > rhs);
+  return Rational::compare(lhs, rhs) <= 0;
 }
 
 bool operator>=(const Rational& lhs, const Rational& rhs) {
-  return !(lhs < rhs);
+  return Rational::compare(lhs, rhs) >= 0;
 }
 
+// Both sides are reduced with a positive denominator, so equal values have
+// equal representations.
 bool operator==(const Rational& lhs, const Rational& rhs) {
-  return !(lhs > rhs) && !(lhs < rhs);
+  lhs.normalize();
+  rhs.normalize();
+  return lhs.numerator_ == rhs.numerator_ &&
+         lhs.denominator_ == rhs.denominator_;
 }
 
 bool operator!=(const Rational& lhs, const Rational& rhs) {
@@ -1,6 +1,8 @@
 #include <iostream>
 #include <string>
 #include <cassert>
+#include <algorithm>
+#include <vector>
 
 #include "biginteger.h"
 
@@ -182,6 +184,516 @@ void vhtest() {
   //std::cout << ((t * h) / s).asDecimal() << '\n';
 }
 
+void testLongMult() {
+  // (10^n - 1)^2 = 10^2n - 2 * 10^n + 1, well past the Karatsuba cutover.
+  BigInteger nines(std::string(2000, '9'));
+  BigInteger square(std::string(1999, '9') + "8" + std::string(1999, '0') +
+                    "1");
+  assert(nines * nines == square);
+  BigInteger power("1" + std::string(500, '0'));
+  assert(nines * power == BigInteger(std::string(2000, '9') +
+                                     std::string(500, '0')));
+  assert(-nines * power == -(power * nines));
+
+  // Operands long enough for the Toom-3 tier.
+  std::string pattern;
+  for (size_t i = 0; i < 600; ++i) {
+    pattern += "123456789";
+  }
+  BigInteger x(pattern);
+  assert((x + 1) * (x - 1) == x * x - 1);
+  assert((x * nines) * x == x * (nines * x));
+
+  // Same products through the NTT engine.
+  size_t ntt_threshold = BigIntegerTuning::ntt_threshold;
+  BigIntegerTuning::ntt_threshold = 64;
+  assert(nines * nines == square);
+  assert(nines * power == BigInteger(std::string(2000, '9') +
+                                     std::string(500, '0')));
+  assert((x + 1) * (x - 1) == x * x - 1);
+  BigIntegerTuning::ntt_threshold = ntt_threshold;
+}
+
+void testLongDiv() {
+  BigInteger x(std::string(700, '7'));
+  BigInteger y("-" + std::string(300, '3') + "1");
+  BigInteger r(std::string(250, '5'));
+  size_t bz_threshold = BigIntegerTuning::bz_threshold;
+  // Schoolbook, then Burnikel-Ziegler down to small blocks.
+  for (size_t threshold : {size_t(1) << 20, size_t(8)}) {
+    BigIntegerTuning::bz_threshold = threshold;
+    assert((x * y - r) / y == x);
+    assert((-x * y + r) / y == -x);
+    assert((x * y - r) / x == y);
+    assert((x * y) / (y * x) == 1);
+    assert(y / x == 0);
+
+    auto [q, rest] = divmod(x * y - r, y);
+    assert(q == x && rest == -r);
+    BigInteger z = x * y - r;
+    BigInteger remainder;
+    z.quotRem(x, remainder);
+    assert(z == y && remainder == -r);
+  }
+  BigIntegerTuning::bz_threshold = bz_threshold;
+
+  assert(BigInteger(-7) % 2 == -1);
+  assert(BigInteger(7) % -2 == 1);
+  assert(BigInteger(-7) / 2 == -3);
+
+  // Word divisors, including ones wider than a decimal limb.
+  WordDivisor big(-1000000000000000003);
+  BigInteger w = -x;
+  assert(w % big == -(x % big));
+  int64_t rest = divmod_word(w, big);
+  assert(w * big.value() + rest == -x && rest < 0);
+  assert(BigInteger(INT64_MIN) / INT64_MIN == 1);
+  assert(BigInteger(INT64_MIN) % INT64_MAX == -1);
+  assert(x % 0 == 0 && x / 0 == 0);
+}
+
+void testToChars() {
+  std::string digits = "-1" + std::string(3000, '0') + "123456789";
+  BigInteger x(digits);
+  size_t radix_threshold = BigIntegerTuning::radix_threshold;
+  BigIntegerTuning::radix_threshold = 2;
+  assert(x.toString() == digits);
+  assert((x - x).toString() == "0");
+  BigIntegerTuning::radix_threshold = radix_threshold;
+
+  std::vector<char> buffer(x.maxDecimalLength());
+  auto [end, error] = to_chars(buffer.data(), buffer.data() + buffer.size(), x);
+  assert(error == std::errc() && std::string(buffer.data(), end) == digits);
+  auto result = to_chars(buffer.data(), buffer.data() + 100, x);
+  assert(result.ec == std::errc::value_too_large);
+}
+
+void testFromChars() {
+  std::string digits = "-" + std::string(2000, '4') + "0000000012345678";
+  size_t radix_threshold = BigIntegerTuning::radix_threshold;
+  BigIntegerTuning::radix_threshold = 2;
+  assert(BigInteger(digits).toString() == digits);
+  BigIntegerTuning::radix_threshold = radix_threshold;
+  assert(BigInteger(digits) == BigInteger(digits.substr(1)) * -1);
+  assert(BigInteger("-00000000000000000000000000042") == -42);
+
+  std::string text = digits + "12x9";
+  BigInteger x;
+  auto [end, error] = from_chars(text.data(), text.data() + text.size(), x);
+  assert(error == std::errc() && end == text.data() + digits.size() + 2);
+  assert(x == BigInteger(digits + "12"));
+  assert(from_chars(text.data(), text.data() + 1, x).ec ==
+         std::errc::invalid_argument);
+  assert(x == BigInteger(digits + "12"));
+}
+
+void testInPlace() {
+  BigInteger step("-" + std::string(60, '9'));
+  BigInteger sum("1" + std::string(80, '0'));
+  const u_int64_t* limbs = &sum[0];
+  for (int i = 0; i < 1000; ++i) {
+    sum += step;
+    sum -= -step * 2;
+    sum += step * -3;
+  }
+  assert(sum == BigInteger("1" + std::string(80, '0')));
+  assert(&sum[0] == limbs);  // no reallocation once the buffer fits
+
+  BigInteger x = step;
+  x -= x;
+  assert(x == 0 && !x.isNegative());
+  x = step;
+  x += x;
+  assert(x == step * 2);
+  x *= x;
+  assert(x == step * step * 4);
+  x /= step;
+  assert(x == step * 4);
+  x %= step * 3;
+  assert(x == step);
+}
+
+void testSmallStorage() {
+  static_assert(sizeof(BigInteger) == 4 * sizeof(void*));
+  BigInteger small = -12345;
+  BigInteger big("-" + std::string(400, '8'));
+  BigInteger copy = big;
+  copy = small;
+  assert(copy == -12345 && big != small);
+  copy = big;
+  BigInteger moved = std::move(copy);
+  assert(moved == big && moved.isNegative());
+  moved = std::move(small);
+  assert(moved == -12345);
+  moved -= moved;
+  assert(moved == 0 && !moved.isNegative());
+}
+
+void testArena() {
+  assert(gcd(BigInteger(-12), 18) == 6);
+  assert(gcd(0, -5) == 5 && gcd(0, 0) == 0);
+  BigInteger x("1" + std::string(300, '0'));
+  assert(gcd(x * 7 + 7, x * 21 + 21) == x * 7 + 7);
+
+  // 1 / (i * (i + 1)) telescopes to n / (n + 1).
+  Rational sum;
+  {
+    BigIntegerArena arena(1 << 12);
+    for (int64_t i = 1; i <= 200; ++i) {
+      sum += Rational(1) / Rational(i * (i + 1));
+    }
+  }
+  assert(sum == Rational(200) / Rational(201));
+}
+
+// A power of two past the Karatsuba threshold whose square needs one limb
+// less than twice its length, so its products come back with a zero top
+// limb in the n + m limb result.
+BigInteger shortProductBase() {
+  BigInteger p = pow(BigInteger(2), 4000);
+  while ((p * p).len() == 2 * p.len()) {
+    p *= 2;
+  }
+  return p;
+}
+
+void testLazy() {
+  BigInteger a("-" + std::string(200, '3'));
+  BigInteger b(std::string(180, '7'));
+  BigInteger c(std::string(190, '1'));
+  BigInteger d = 12345;
+  BigInteger x = lazy(a) * b + lazy(c) * d;
+  assert(x == a * b + c * d);
+  x = lazy(a) * b - c - lazy(d) * d;
+  assert(x == a * b - c - d * d);
+  x = -(lazy(a) * b) + (lazy(c) - d) * (lazy(c) + d);
+  assert(x == c * c - d * d - a * b);
+  x = lazy(x) * a + x;  // the destination is also an operand
+  assert(x == (c * c - d * d - a * b) * (a + 1));
+
+  // Destinations longer than the product but shorter than both factors.
+  BigInteger p = shortProductBase();
+  BigInteger q = p / 1024;
+  BigInteger acc = p * q + p;
+  acc = acc - lazy(p) * q;
+  assert(acc == p);
+  acc = lazy(p) * q + p;
+  x = lazy(acc) - lazy(p) * q;
+  assert(x == p);
+  x = -(lazy(p) * p) + (lazy(p) * p + 7);
+  assert(x == 7);
+}
+
+void testAddmul() {
+  BigInteger x("-" + std::string(100, '6'));
+  BigInteger y(std::string(400, '2'));
+  BigInteger acc = 5;
+  addmul(acc, x, y);
+  assert(acc == x * y + 5);
+  submul(acc, x, y);
+  assert(acc == 5);
+  submul(acc, x, x);
+  assert(acc == 5 - x * x);
+  addmul_word(acc, x, -9);
+  assert(acc == 5 - x * x - x * 9);
+  addmul(acc, acc, y);
+  assert(acc == (5 - x * x - x * 9) * (y + 1));
+
+  // Accumulators longer than the product but shorter than both operands.
+  BigInteger p = shortProductBase();
+  for (BigInteger q : {p, p / 1024}) {
+    BigInteger start = p * q + p;
+    acc = start;
+    submul(acc, p, q);
+    assert(acc == p);
+    acc = start;
+    addmul(acc, -p, q);
+    assert(acc == p);
+    acc = -start;
+    addmul(acc, p, q);
+    assert(acc == -p);
+  }
+}
+
+void testSquare() {
+  // Squares go through their own kernels; a copy forces the general product.
+  std::string pattern;
+  for (size_t i = 0; i < 700; ++i) {
+    pattern += std::to_string(i * 7919 % 1000);
+  }
+  size_t ntt_threshold = BigIntegerTuning::ntt_threshold;
+  size_t square_threshold = BigIntegerTuning::square_threshold;
+  for (size_t digits : {1, 9, 10, 19, 20, 100, 500, 2000}) {
+    BigInteger x("-" + pattern.substr(0, digits));
+    BigInteger copy = x;
+    assert(square(x) == x * copy);
+    assert(square(x) == square(-x));
+    BigIntegerTuning::ntt_threshold = 64;
+    BigIntegerTuning::square_threshold = 1;
+    assert(square(x) == x * copy);
+    BigIntegerTuning::ntt_threshold = ntt_threshold;
+    BigIntegerTuning::square_threshold = square_threshold;
+    copy *= copy;
+    assert(copy == x * x);
+  }
+  BigInteger nines(std::string(500, '9'));
+  assert(square(nines) == BigInteger(std::string(499, '9') + "8" +
+                                     std::string(499, '0') + "1"));
+  assert(square(BigInteger(0)) == 0);
+}
+
+void testGcd() {
+  // gcd(F(i), F(j)) == F(gcd(i, j)); consecutive Fibonacci numbers are the
+  // slowest case for Euclid.
+  std::vector<BigInteger> fib = {0, 1};
+  for (size_t i = 2; i <= 3000; ++i) {
+    fib.push_back(fib[i - 1] + fib[i - 2]);
+  }
+  size_t half_gcd_threshold = BigIntegerTuning::half_gcd_threshold;
+  // Thresholds below two are clamped rather than looping on a zero divisor.
+  for (size_t threshold : {half_gcd_threshold, size_t(4), size_t(1),
+                           size_t(0)}) {
+    BigIntegerTuning::half_gcd_threshold = threshold;
+    assert(gcd(fib[3000], fib[2999]) == 1);
+    assert(gcd(fib[3000], fib[2400]) == fib[600]);
+    assert(gcd(-fib[2000], fib[1500]) == fib[500]);
+    BigInteger common = fib[1777] * 1000003;
+    assert(gcd(fib[2900] * common, fib[2899] * common) == common);
+    assert(gcd(common, 0) == common && gcd(common, common) == common);
+  }
+  BigIntegerTuning::half_gcd_threshold = half_gcd_threshold;
+}
+
+void testRationalReduce() {
+  Rational a(BigInteger(-6), BigInteger(35));
+  Rational b(BigInteger(14), BigInteger(-15));
+  assert((a * b).toString() == "4/25");
+  assert((a / b).toString() == "9/49");
+  assert((b / a).toString() == "49/9");
+  assert((a + b).toString() == "-116/105");
+  assert((a - b).toString() == "16/21");
+  assert((a - a).toString() == "0" && (a * 0).toString() == "0");
+  assert((Rational(1, 6) + Rational(1, 3)).toString() == "1/2");
+  assert((Rational(5, 6) - Rational(1, 3)).toString() == "1/2");
+
+  // sum of 1 / (i * (i + 1) * (i + 2)) for i = 1..n is
+  // 1/4 - 1 / (2 * (n + 1) * (n + 2)).
+  Rational sum;
+  Rational product = 1;
+  for (int64_t i = 1; i <= 300; ++i) {
+    sum += Rational(1, i * (i + 1) * (i + 2));
+    product *= Rational(i + 1, i);
+  }
+  assert(sum == Rational(1, 4) - Rational(1, 2 * 301 * 302));
+  assert(product.toString() == "301");
+
+  // The numerator's limbs are exactly full, and the other cross product is
+  // shorter but padded with a zero top limb.
+  BigInteger p = pow(BigInteger(2), 4000);
+  while ((p / 2).len() == p.len()) {
+    p *= 2;
+  }
+  Rational a_part(p * p / 8 - 1, p + 1);
+  Rational b_part(p - 1, 16);
+  assert(a_part - b_part == Rational(p * p - 15, (p + 1) * 16));
+  assert(-b_part + a_part == Rational(p * p - 15, (p + 1) * 16));
+  assert(Rational(p * p, 7) - Rational(1, p - 1) ==
+         Rational(p * p * (p - 1) - 7, (p - 1) * 7));
+}
+
+void testRationalCompare() {
+  BigInteger big("1" + std::string(200, '0'));
+  Rational third(1, 3);
+  Rational close(big, big * 3 + 1);
+  assert(close < third && third > close && close != third);
+  assert(-third < -close && -close >= -third);
+  assert(Rational(big * 2, big * 6) == third && third <= Rational(2, 6));
+  assert(Rational(-1, 3) < 0 && Rational(0) < close && !(third < third));
+  assert(Rational(big, 7) > Rational(big, 8) && Rational(-big, 7) < -big / 8);
+
+  std::vector<Rational> values = {third, -third, close, 0, Rational(big, 3),
+                                  Rational(-7, 2), Rational(1, big)};
+  std::sort(values.begin(), values.end());
+  for (size_t i = 1; i < values.size(); ++i) {
+    assert(values[i - 1] < values[i]);
+  }
+  assert(values.front() == Rational(-7, 2) && values[2] == 0);
+}
+
+void testLazyRational() {
+  size_t lazy_rational_limbs = BigIntegerTuning::lazy_rational_limbs;
+  std::vector<std::string> results;
+  for (size_t limbs : {size_t(0), size_t(6), size_t(1000)}) {
+    BigIntegerTuning::lazy_rational_limbs = limbs;
+    Rational sum;
+    Rational product = 1;
+    for (int64_t i = 1; i <= 60; ++i) {
+      sum += Rational(i % 7 - 3, i * (i + 1));
+      product *= Rational(i + 1, i);
+      sum -= Rational(1, 5) / product;
+    }
+    Rational same = Rational(2, 9) + Rational(4, 9);
+    assert(same == Rational(2, 3) && same.toString() == "2/3");
+    assert(product == 61 && product > sum && sum < 0);
+    results.push_back(sum.toString() + " " + sum.asDecimal(30));
+  }
+  assert(results[0] == results[1] && results[0] == results[2]);
+  BigIntegerTuning::lazy_rational_limbs = lazy_rational_limbs;
+}
+
+void testPowmod() {
+  assert(powmod(3, 1000, 1000000007) == 56888193);
+  assert(powmod(-7, 77, 1000) == 793);
+  assert(powmod(2, 521, BigInteger("931322574615478515625")) ==
+         BigInteger("568545936860450994652"));
+  assert(powmod(BigInteger("12345678901234567890"), 98765,
+                BigInteger("18446744073709551617")) ==
+         BigInteger("1231180392319468113"));
+  assert(powmod(5, 0, 7) == 1 && powmod(5, 3, 1) == 0 && powmod(5, 3, 0) == 0);
+  assert(powmod(5, -3, 7) == 0 && powmod(0, 0, 9) == 1);
+
+  // Fermat: a^(p - 1) == 1 mod p for the Mersenne prime p = 2^127 - 1, with
+  // the context shared across calls.
+  BigInteger p("170141183460469231731687303715884105727");
+  MontgomeryContext context(p);
+  for (int64_t a : {2, 3, -10, 123456789}) {
+    assert(context.powmod(a, p - 1) == 1);
+    assert(context.powmod(a, p) == (a % p + p) % p);
+  }
+
+  // Odd, even and multiple-of-five moduli agree with repeated squaring.
+  BigInteger base("-" + std::string(120, '7'));
+  BigInteger exponent(std::string(40, '3'));
+  for (BigInteger modulus : {p * p, p * 2, p * 5, p * 10 + 3}) {
+    BigInteger expected = 1;
+    BigInteger square = (base % modulus + modulus) % modulus;
+    for (BigInteger e = exponent; e > 0; e /= 2) {
+      if (e % 2 == 1) {
+        expected = expected * square % modulus;
+      }
+      square = square * square % modulus;
+    }
+    assert(powmod(base, exponent, modulus) == expected);
+    assert(powmod(base, exponent, -modulus) == expected);
+  }
+}
+
+void testBigModulus() {
+  BigInteger p("170141183460469231731687303715884105727");
+  for (BigInteger divisor :
+       {p, -p * p, BigInteger(1), BigInteger(1000000000)}) {
+    BigModulus modulus(divisor);
+    BigInteger m = divisor.abs();
+    BigInteger x("-" + std::string(150, '8'));
+    BigInteger y(std::string(90, '4'));
+    BigInteger rx = (x % m + m) % m;
+    BigInteger ry = y % m;
+    assert(modulus.reduce(x) == rx && modulus.reduce(y) == ry);
+    assert(modulus.reduce(x * x * y) == x * x * y % m);
+    assert(modulus.mulmod(x, y) == (x * y % m + m) % m);
+    assert(modulus.addmod(rx, ry) == (rx + ry) % m);
+    assert(modulus.submod(rx, ry) == ((rx - ry) % m + m) % m);
+    assert(modulus.addmod(x, y) == ((x + y) % m + m) % m);
+    assert(modulus.reduce(m) == 0 && modulus.reduce(m - 1) == m - 1);
+  }
+  assert(BigModulus(0).reduce(5) == 0);
+}
+
+void testPowRoot() {
+  // Powers of the radix's digit base become shifts.
+  BigInteger ten = 10, zero = 0;
+  assert(pow(ten, 0) == 1 && pow(zero, 5) == 0 && pow(zero, 0) == 1);
+  assert(pow(ten, 75) == BigInteger("1" + std::string(75, '0')));
+  assert(pow(-ten * 100, 41) == BigInteger("-1" + std::string(123, '0')));
+  BigInteger two = 1;
+  for (int i = 0; i < 200; ++i) {
+    two *= 2;
+  }
+  assert(pow(BigInteger(2), 200) == two && pow(BigInteger(-2), 200) == two);
+  assert(pow(BigInteger(4), 100) == two);
+  assert(pow(BigInteger(-2), 201) == -two * 2);
+
+  BigInteger x("-123456789" + std::string(40, '0'));
+  BigInteger expected = 1;
+  for (int i = 0; i < 13; ++i) {
+    expected *= x;
+  }
+  assert(pow(x, 13) == expected && pow(x, 12) == expected / x);
+
+  // Perfect powers and their neighbours, large enough to seed Newton's
+  // iteration from the root of the leading limbs.
+  BigInteger base("98765432109876543210987654321" + std::string(60, '3'));
+  for (uint64_t k : {2, 3, 5, 7}) {
+    BigInteger power = pow(base, k);
+    assert(iroot(power, k) == base);
+    assert(iroot(power - 1, k) == base - 1);
+    assert(iroot(power + 1, k) == base);
+    assert(iroot(-power, k) == (k % 2 ? -base : 0));
+  }
+  assert(isqrt(pow(base, 2) - 1) == base - 1);
+  assert(isqrt(99) == 9 && isqrt(100) == 10 && isqrt(1) == 1);
+  assert(iroot(7, 3) == 1 && iroot(8, 3) == 2 && iroot(two, 200) == 2);
+  assert(iroot(-27, 3) == -3 && iroot(5, 0) == 0 && isqrt(-4) == 0);
+}
+
+void testProducts() {
+  std::vector<BigInteger> values;
+  BigInteger folded = 1;
+  for (int64_t i = 1; i <= 300; ++i) {
+    values.push_back(i * i - 1000);
+    folded *= i * i - 1000;
+  }
+  assert(product(values) == folded);
+  assert(product(values.begin(), values.begin()) == 1);
+  assert(product({BigInteger(-3), BigInteger(4), BigInteger(5)}) == -60);
+
+  BigInteger expected = 1;
+  for (uint64_t n = 0; n <= 400; ++n) {
+    if (n) {
+      expected *= static_cast<int64_t>(n);
+    }
+    assert(factorial(n) == expected);
+  }
+
+  // Pascal's rule, through both the sieve and the quotient paths.
+  for (uint64_t n : {3, 10, 97, 300, 1000, 4096}) {
+    for (uint64_t k : {uint64_t(1), uint64_t(2), n / 3, n / 2, n - 1}) {
+      assert(binomial(n, k) == binomial(n - 1, k - 1) + binomial(n - 1, k));
+    }
+  }
+  assert(binomial(300, 150) == factorial(300) / square(factorial(150)));
+  assert(binomial(5, 0) == 1 && binomial(5, 5) == 1 && binomial(5, 6) == 0);
+  assert(binomial(100000, 3) == BigInteger("166661666700000"));
+  // Factors past INT64_MAX.
+  BigInteger max("18446744073709551615");
+  assert(binomial(UINT64_MAX, 1) == max);
+  assert(binomial(UINT64_MAX, 2) == max * (max - 1) / 2);
+}
+
+void testParallelMul() {
+  std::string pattern;
+  for (size_t i = 0; i < 700; ++i) {
+    pattern += "987654321";
+  }
+  BigInteger x(pattern);
+  BigInteger y = x / 7 + 12345;
+  BigInteger product = x * y;
+  BigInteger square = x * x;
+
+  // Every Karatsuba, Toom-3 and NTT subproduct large enough forks.
+  size_t mul_threads = BigIntegerTuning::mul_threads;
+  size_t parallel_threshold = BigIntegerTuning::parallel_threshold;
+  size_t ntt_threshold = BigIntegerTuning::ntt_threshold;
+  BigIntegerTuning::mul_threads = 4;
+  BigIntegerTuning::parallel_threshold = 8;
+  assert(x * y == product && x * x == square);
+  BigIntegerTuning::ntt_threshold = 64;
+  assert(x * y == product && x * x == square);
+  BigIntegerTuning::mul_threads = mul_threads;
+  BigIntegerTuning::parallel_threshold = parallel_threshold;
+  BigIntegerTuning::ntt_threshold = ntt_threshold;
+}
+
 int main() {
 #ifdef IO
   testIO();
@@ -208,5 +720,24 @@ int main() {
   testRational();
 #endif
 vhtest();
+testLongMult();
+testLongDiv();
+testToChars();
+testFromChars();
+testInPlace();
+testSmallStorage();
+testArena();
+testLazy();
+testAddmul();
+testSquare();
+testGcd();
+testRationalReduce();
+testRationalCompare();
+testLazyRational();
+testPowmod();
+testBigModulus();
+testPowRoot();
+testProducts();
+testParallelMul();
   return 0;
 }
\ No newline at end of file